@@ -9,6 +9,7 @@
 #include <EventScheduler.h>
 #include <SearchEngine.h>
 #include <Catalogue.h>
+#include <Metrics.h>
 #include <Interval.h>
 #include <iostream>
 #include <sstream>
@@ -16,6 +17,8 @@
 #include <string>
 #include <utility>
 #include <list>
+#include <algorithm>
+#include <unordered_map>
 
  /**
   *  I know these will quickly go out of date and that these are usually handled
@@ -38,12 +41,32 @@ class Application
     {
         size_t id;
         double priority;
+        bool required;
+    };
+
+    /**
+     *  @brief To hold a choice group: any one of several classes.
+     */
+    struct ChoiceGroup
+    {
+        std::vector<size_t> ids;
+        double priority;
+        bool required;
     };
 
     /* ---------------------------------------------------------------- */
     Catalogue cat;
     std::vector<Selection> sel;
+    std::vector<ChoiceGroup> groups;
     std::vector<IntervalGroup> excl;
+    std::vector<size_t> last_search;
+
+    /* Scheduler kept between builds, so that each build only adds and
+       removes the events that changed and starts from the last result. */
+    EventScheduler sched;
+    std::unordered_map<size_t, Selection> sched_sel;
+    size_t sched_groups;
+    size_t sched_excl;
 
     /**
      *  @brief Prints welcome message to standard out.
@@ -102,6 +125,12 @@ class Application
         std::string terms = GetResponse("Please enter \033[0;36msearch\033[0m term(s): ");
         auto results = cat.search(terms, 10);
 
+        // Remember the results, so they can be added as a choice group.
+        last_search.clear();
+        for (const auto& result : results) {
+            last_search.push_back(result.id);
+        }
+
         // If no results, end early and spit out error.
         if (results.size() == 0) {
             std::cout << "There are \033[0;36mno\033[0m results for those search term(s)."
@@ -128,6 +157,48 @@ class Application
         }
     }
 
+    /**
+     *  @brief Asks the user for a priority.
+     *  @return The priority entered.
+     */
+    double GetPriority()
+    {
+        std::string str_priority;
+        
+        while (str_priority.empty() || !isdigit(str_priority.at(0))) {
+            str_priority = GetResponse("Please enter an integral "
+                "\033[0;36mpriority\033[0m (larger means more preferred): ");
+        }
+        
+        return ParseNumber<double>(str_priority);
+    }
+
+    /**
+     *  @brief Asks the user whether a selection must be in every schedule.
+     *  @param subject Start of the question, e.g. "Is this class".
+     *  @return True if the user answered yes.
+     */
+    bool GetRequired(const std::string& subject)
+    {
+        std::string required_str = GetResponse(subject +
+            " \033[0;36mrequired\033[0m? (y/n) ");
+        return required_str.size() > 0
+            && std::tolower(required_str.at(0)) == 'y';
+    }
+
+    /**
+     *  @brief Returns whether a class is part of a choice group.
+     */
+    bool InChoiceGroup(size_t id) const
+    {
+        for (const auto& group : groups) {
+            if (std::find(group.ids.begin(), group.ids.end(), id) != group.ids.end()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     /**
      *  @brief Attempts to add event to selection.
      */
@@ -143,6 +214,13 @@ class Application
             return;
         }
 
+        // Every class may only be scheduled once.
+        if (InChoiceGroup(id)) {
+            std::cout << "\nThat class is already part of a \033[0;36mchoice group\033[0m."
+                << std::endl;
+            return;
+        }
+
         // Double-check -f they want to add this event.
         std::string confirm_str = GetResponse(
             "Add class with name \033[0;36m'" + cat.at(id).name + "'\033[0m?"
@@ -156,22 +234,57 @@ class Application
             return;
         }
 
-        // Parse priority.
-        std::string str_priority;
-        
-        while (str_priority.empty() || !isdigit(str_priority.at(0))) {
-            str_priority = GetResponse("Please enter an integral "
-                "\033[0;36mpriority\033[0m (larger means more preferred): ");
-        }
-        
-        double priority = ParseNumber<double>(str_priority);
+        double priority = GetPriority();
+        bool required = GetRequired("Is this class");
 
         // Add to list of selections.
-        sel.push_back({ id, priority });
+        sel.push_back({ id, priority, required });
         std::cout << std::endl;
         std::cout << "\033[0;36m" << cat.at(id).name << " has been added!\033[0m" << std::endl << std::endl;
     }
 
+    /**
+     *  @brief Adds the classes of the last search as a choice group, of which
+     *         at most one is scheduled.
+     */
+    void AddChoiceGroup()
+    {
+        // Every class may only be scheduled once, so leave out classes that
+        // were already selected.
+        std::vector<size_t> ids;
+        for (size_t id : last_search) {
+            bool selected = InChoiceGroup(id);
+            for (const auto& selection : sel) {
+                selected = selected || selection.id == id;
+            }
+            if (!selected) {
+                ids.push_back(id);
+            }
+        }
+
+        if (ids.size() == 0) {
+            std::cout << "\nThere are \033[0;36mno\033[0m classes from the last search"
+                " to add." << std::endl;
+            return;
+        }
+
+        // Double-check they want to add these events.
+        std::string confirm_str = GetResponse("Add a choice group of the "
+            "\033[0;36m" + std::to_string(ids.size()) + "\033[0m classes from the"
+            " last search? (y/n) ");
+        if (confirm_str.size() == 0 || std::tolower(confirm_str.at(0)) == 'n') {
+            return;
+        }
+
+        double priority = GetPriority();
+        bool required = GetRequired("Is one of these classes");
+
+        groups.push_back({ ids, priority, required });
+        std::cout << std::endl;
+        std::cout << "\033[0;36mChoice group #" << groups.size() - 1
+            << " has been added!\033[0m" << std::endl << std::endl;
+    }
+
     /**
      *  @brief Lists all selections.
      */
@@ -205,7 +318,18 @@ class Application
                 std::cout << std::left << "  "
                     << std::setw(len) << cat.at(s.id).name
                     << std::setw(event_len) << s.id
-                    << s.priority << std::endl;
+                    << s.priority << (s.required ? " (required)" : "")
+                    << std::endl;
+            }
+        }
+
+        // List choice groups.
+        for (size_t i = 0; i < groups.size(); ++i) {
+            std::cout << "\nChoice group #" << i << ", priority "
+                << groups.at(i).priority
+                << (groups.at(i).required ? " (required)" : "") << ":" << std::endl;
+            for (size_t id : groups.at(i).ids) {
+                std::cout << "  " << cat.at(id).name << "  " << id << std::endl;
             }
         }
 
@@ -235,28 +359,66 @@ class Application
      */
     void DoBuild()
     {
-        if (sel.size() == 0) {
+        if (sel.size() == 0 && groups.size() == 0) {
             std::cout << "\nYou have \033[0;36mno\033[0m current selections." << std::endl;
             return;
         }
 
-        // add selections
-        EventScheduler sched;
+        // selections to schedule; the first selection of a class is used
+        std::unordered_map<size_t, Selection> wanted;
+        for (const auto& selection: sel) {
+            wanted.emplace(selection.id, selection);
+        }
+
+        // remove selections that were dropped or changed since the last build
+        for (auto it = sched_sel.begin(); it != sched_sel.end(); ) {
+            auto found = wanted.find(it->first);
+            if (found == wanted.end()
+                || found->second.priority != it->second.priority
+                || found->second.required != it->second.required) {
+                sched.removeEvent((unsigned int)it->first);
+                it = sched_sel.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // add new selections
         for (const auto& selection: sel) {
-            const Event& event = cat.at(selection.id).event;
+            if (sched_sel.count(selection.id) == 0) {
+                const Event& event = cat.at(selection.id).event;
+
+                sched.addEvent(event, (unsigned int)selection.id,
+                    selection.priority, selection.required);
+                sched_sel.emplace(selection.id, selection);
+            }
+        }
 
-            sched.addEvent(event, (unsigned int)selection.id, selection.priority);
+        // add new choice groups; use id's >= 0xF0000000, which no class has
+        for (; sched_groups < groups.size(); ++sched_groups) {
+            const ChoiceGroup& group = groups.at(sched_groups);
+            std::vector<EventScheduler::ChoiceMember> members;
+            for (size_t id : group.ids) {
+                members.push_back({ cat.at(id).event, (unsigned int)id, group.priority });
+            }
+            sched.addChoiceGroup(members,
+                (unsigned int)(0xF0000000 + sched_groups), group.required);
         }
 
-        // add exclusions; use event id's >= 0xF000000
-        unsigned int exclusion_id = 0xF0000000;
-        for (const auto& exclusion: excl) {
-            sched.addEvent(Event({exclusion}), exclusion_id, 1000000.0);
-            ++exclusion_id;
+        // add new exclusions; sections that overlap them are never searched
+        for (; sched_excl < excl.size(); ++sched_excl) {
+            sched.addExclusion(excl.at(sched_excl));
         }
 
-        // Print out result!
-        auto result = sched.buildApproxSchedule();
+        // Print out result! The scheduler picks the exact search for small
+        // requests and the beam for large ones
+        auto result = sched.autoSchedule();
+
+        if (!sched.isFeasible()) {
+            std::cout << "\nYour \033[0;36mrequired\033[0m classes cannot all "
+                "be scheduled together." << std::endl << std::endl;
+            return;
+        }
 
         // determine which classes could not be scheduled
         size_t num_scheduled = 0;
@@ -275,6 +437,21 @@ class Application
             }
         }
 
+        for (size_t i = 0; i < groups.size(); ++i) {
+            bool found = false;
+            for (const auto& [entry_id, _] : result) {
+                const auto& ids = groups.at(i).ids;
+                found = found || std::find(ids.begin(), ids.end(), entry_id) != ids.end();
+            }
+            if (found) {
+                ++num_scheduled;
+            } else {
+                std::cout << "\nUnable to schedule any class of choice group "
+                    "\033[0;36m#" << i << "\033[0m due to unresolvable conflicts"
+                    << std::endl;
+            }
+        }
+
         if (num_scheduled == 0) {
             std::cout << "\nYour schedule is \033[0;36mempty\033[0m."
                 << std::endl << std::endl;
@@ -289,11 +466,6 @@ class Application
         "                    ╚═════════════════════════════╝\033[0m\n\n";
 
         for (const auto& [entry_id, section_id] : result) {
-            // ignore exclusions
-            if (entry_id >= 0xF0000000) {
-                continue;
-            }
-
             std::cout << "  \033[0;36m'" << cat.at(entry_id).name << "'\033[0m"
                 << std::endl;
 
@@ -377,6 +549,8 @@ class Application
             "  (l|L)  \033[0;36mlist\033[0m currently selected classes\n"
             "  (q|Q)  \033[0;36mquit\033[0m the application\n"
             "  (e|E)  \033[0;36mexclude\033[0m a time interval\n"
+            "  (g|G)  add any one of the last search results as a \033[0;36mchoice group\033[0m\n"
+            "  (m|M)  show how long searches and builds took (\033[0;36mmetrics\033[0m)\n"
             "  (1-9)  \033[0;36madd\033[0m a class by id number\n\n";
     }
 
@@ -425,6 +599,20 @@ class Application
             ListSelections();
             break;
 
+            // Metrics.
+        case 'm':
+        case 'M':
+            std::cout << std::endl;
+            Metrics::global().dump(std::cout);
+            std::cout << std::endl;
+            break;
+
+            // Choice group.
+        case 'g':
+        case 'G':
+            AddChoiceGroup();
+            break;
+
             // Exclude.
         case 'e':
         case 'E':
@@ -460,7 +648,8 @@ public:
      *  Default constructor.
      */
     Application()
-        : cat(), sel(), excl()
+        : cat(), sel(), groups(), excl(), last_search(), sched(), sched_sel(),
+          sched_groups(0), sched_excl(0)
     {
     }
 
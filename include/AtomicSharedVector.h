@@ -0,0 +1,176 @@
+
+#ifndef ATOMIC_SHARED_VECTOR_H
+#define ATOMIC_SHARED_VECTOR_H
+
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+
+// AtomicSharedVector
+// A SharedVector whose copies may be used from different threads at once.
+// The reference count is atomic, and a buffer is never written where another
+// copy can read it: a copy only appends to a shared buffer by claiming the
+// slot just past its own elements, which no copy with fewer elements ever
+// reads and which only one copy can claim. A copy that loses that race, or
+// finds the buffer full, copies its elements into a buffer of its own
+// instead of resizing the shared one. Copies themselves are not synchronized,
+// so one copy must not be used from two threads at once
+template <class T>
+class AtomicSharedVector {
+    private:
+
+        // An underlying reference counted buffer; size is the number of slots
+        // that some copy has claimed, and only grows
+        struct Vector {
+            T * data;
+            const size_t cap;
+            std::atomic<size_t> size;
+            std::atomic<size_t> refCount;
+
+            // Constructor for an empty Vector with room for capacity elements
+            Vector(size_t capacity) :
+                data(new T[capacity]),
+                cap(capacity),
+                size(0),
+                refCount(1) {}
+
+            // Constructor which copies only the first n elements from another
+            // Vector into a buffer with room for capacity elements
+            Vector(const Vector& vec, size_t nElems, size_t capacity) :
+                data(new T[capacity]),
+                cap(capacity),
+                size(nElems),
+                refCount(1) {
+
+                std::copy(vec.data, vec.data + nElems, this -> data);
+            }
+
+            Vector(const Vector& vec) = delete;
+            Vector& operator=(const Vector& rhs) = delete;
+
+            ~Vector() {
+                delete[] this -> data;
+            }
+        };
+
+        // internal count of how many elements are being used; this may be less
+        // than are stored in the underlying vector
+        size_t size;
+
+        // reference to the underlying vector
+        Vector * vec;
+
+        // the queued element and whether an element is currently queued
+        T queued;
+        bool queueFull;
+
+        // release
+        // drop a reference to a buffer, freeing it if it was the last one
+        static void release(Vector * buffer) {
+            if (buffer -> refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete buffer;
+            }
+        }
+
+    public:
+
+        // Constructor for empty AtomicSharedVector
+        AtomicSharedVector() : size(0), vec(new Vector(1)), queued(),
+            queueFull(false) {}
+
+        // Copy constructor: increases underlying vector's reference count
+        // instead of copying
+        AtomicSharedVector(const AtomicSharedVector& rhs) : size(rhs.size),
+            vec(rhs.vec), queued(rhs.queued), queueFull(rhs.queueFull) {
+
+            this -> vec -> refCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Copy assignment: increases underlying vector's reference count
+        // instead of copying
+        AtomicSharedVector& operator=(const AtomicSharedVector& rhs) {
+            if (&rhs != this) {
+                rhs.vec -> refCount.fetch_add(1, std::memory_order_relaxed);
+                release(this -> vec);
+
+                this -> vec = rhs.vec;
+                this -> size = rhs.size;
+                this -> queued = rhs.queued;
+                this -> queueFull = rhs.queueFull;
+            }
+            return *this;
+        }
+
+        // destructor: only frees underlying vector if reference count is zero
+        ~AtomicSharedVector() {
+            release(this -> vec);
+        }
+
+        // queue
+        // queue an element to be added, but do not actually add it yet
+        void queue(const T& value) {
+            this -> queued = value;
+            this -> queueFull = true;
+        }
+
+        // flushQueue
+        // add a queued element (if any) to the underlying vector
+        void flushQueue() {
+            if (!this -> queueFull) {
+                return;
+            }
+
+            // claim the slot after our elements; this fails if another copy
+            // already appended after the same elements
+            size_t claimed = this -> size;
+            if (this -> size >= this -> vec -> cap
+                || !this -> vec -> size.compare_exchange_strong(claimed,
+                this -> size + 1, std::memory_order_relaxed)) {
+
+                // copy our elements into a buffer of our own, doubling it if
+                // the shared buffer was full
+                size_t capacity = this -> size < this -> vec -> cap
+                    ? this -> vec -> cap : this -> vec -> cap * 2;
+                Vector * oldVec = this -> vec;
+                this -> vec = new Vector(*oldVec, this -> size, capacity);
+                this -> vec -> size.store(this -> size + 1,
+                    std::memory_order_relaxed);
+                release(oldVec);
+            }
+
+            // append the element
+            this -> vec -> data[this -> size] = this -> queued;
+            this -> size += 1;
+            this -> queueFull = false;
+        }
+
+        // getArray
+        // get an immutable pointer to the data
+        const T * getArray() const {
+            return this -> vec -> data;
+        }
+
+        // getSize
+        // get the size number of elements in the AtomicSharedVector
+        size_t getSize() const {
+            return this -> size;
+        }
+
+        // display
+        // display the vector contents to stdout
+        void display() const {
+
+            // display the reference count and reference
+            std::cout << "(" << this -> vec -> refCount.load() << " @"
+                << (void*)this -> vec -> data << ")";
+
+            // display the elements in the vector
+            std::cout << " [";
+            for (size_t i = 0; i < this -> size; ++i) {
+                std::cout << this -> vec -> data[i] << ", ";
+            }
+            std::cout << "]" << std::endl;
+        }
+};
+
+#endif // ATOMIC_SHARED_VECTOR_H
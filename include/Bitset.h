@@ -0,0 +1,293 @@
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <vector>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <utility>
+
+// Bitset
+// A fixed size set of bits whose size is chosen at runtime; it is used for
+// rows of the conflicts graph and for the domains of feasible sections, so the
+// operations that matter are word at a time AND / AND NOT and checking whether
+// any bit in a range of indices is still set. The words are allocated from a
+// memory resource, so that short lived sets can come from a ScratchArena
+class Bitset {
+    public:
+        typedef std::pmr::polymorphic_allocator<uint64_t> allocator_type;
+
+    private:
+
+        // the bits, packed 64 to a word; unused bits of the last word are
+        // always kept as zero
+        std::pmr::vector<uint64_t> words;
+
+        // the number of bits in the set
+        size_t nBits;
+
+        static const size_t WORD_BITS = 64;
+
+        // rangeMask
+        // mask of the bits of word w that lie in [begin, end)
+        static uint64_t rangeMask(size_t w, size_t begin, size_t end) {
+            uint64_t mask = ~(uint64_t)0;
+            size_t wordStart = w * WORD_BITS;
+
+            if (begin > wordStart) {
+                mask &= ~(uint64_t)0 << (begin - wordStart);
+            }
+            if (end < wordStart + WORD_BITS) {
+                mask &= ~(~(uint64_t)0 << (end - wordStart));
+            }
+
+            return mask;
+        }
+
+        // clearPadding
+        // zero the bits of the last word that lie beyond nBits
+        void clearPadding() {
+            if (this -> nBits % WORD_BITS != 0) {
+                this -> words.back() &=
+                    ~(~(uint64_t)0 << (this -> nBits % WORD_BITS));
+            }
+        }
+
+    public:
+
+        // Constructor for an empty Bitset
+        Bitset() : words(), nBits(0) {}
+
+        // Constructor for a Bitset of n bits, all set to value
+        Bitset(size_t n, bool value = false,
+            const allocator_type& alloc = allocator_type()) :
+            words((n + WORD_BITS - 1) / WORD_BITS,
+                value ? ~(uint64_t)0 : (uint64_t)0, alloc),
+            nBits(n) {
+
+            this -> clearPadding();
+        }
+
+        // Copy constructors; a copy uses the default memory resource unless
+        // given another
+        Bitset(const Bitset& rhs) = default;
+        Bitset(const Bitset& rhs, const allocator_type& alloc) :
+            words(rhs.words, alloc),
+            nBits(rhs.nBits) {}
+
+        Bitset(Bitset&& rhs) = default;
+        Bitset& operator=(const Bitset& rhs) = default;
+        Bitset& operator=(Bitset&& rhs) = default;
+
+        // resize
+        // change the number of bits in the set; bits that are added are clear
+        void resize(size_t n) {
+            this -> words.resize((n + WORD_BITS - 1) / WORD_BITS, 0);
+            this -> nBits = n;
+            if (n > 0) {
+                this -> clearPadding();
+            }
+        }
+
+        // assign
+        // make this a set of n bits, all set to value, reusing the existing
+        // buffer when it is large enough
+        void assign(size_t n, bool value) {
+            this -> words.assign((n + WORD_BITS - 1) / WORD_BITS,
+                value ? ~(uint64_t)0 : (uint64_t)0);
+            this -> nBits = n;
+            if (n > 0) {
+                this -> clearPadding();
+            }
+        }
+
+        // erase
+        // remove the bits whose index is set in drop, moving the bits after
+        // them down to fill their place; drop must be at least as large as
+        // this set
+        void erase(const Bitset& drop) {
+            Bitset kept(this -> nBits - drop.countInRange(0, this -> nBits), false);
+            size_t next = 0;
+            for (size_t i = 0; i < this -> nBits; ++i) {
+                if (drop.test(i)) {
+                    continue;
+                }
+                if (this -> test(i)) {
+                    kept.set(next);
+                }
+                ++next;
+            }
+            *this = std::move(kept);
+        }
+
+        // size
+        // the number of bits in the set
+        size_t size() const {
+            return this -> nBits;
+        }
+
+        // test
+        // return whether bit i is set
+        bool test(size_t i) const {
+            return (this -> words[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+        }
+
+        // set
+        // set bit i
+        void set(size_t i) {
+            this -> words[i / WORD_BITS] |= (uint64_t)1 << (i % WORD_BITS);
+        }
+
+        // reset
+        // clear bit i
+        void reset(size_t i) {
+            this -> words[i / WORD_BITS] &= ~((uint64_t)1 << (i % WORD_BITS));
+        }
+
+        // resetRange
+        // clear every bit with an index in [begin, end)
+        void resetRange(size_t begin, size_t end) {
+            if (begin >= end) {
+                return;
+            }
+
+            size_t lastWord = (end - 1) / WORD_BITS;
+            for (size_t w = begin / WORD_BITS; w <= lastWord; ++w) {
+                this -> words[w] &= ~rangeMask(w, begin, end);
+            }
+        }
+
+        // operator&=
+        // keep only the bits that are also set in rhs; both sets must be the
+        // same size
+        Bitset& operator&=(const Bitset& rhs) {
+            for (size_t w = 0; w < this -> words.size(); ++w) {
+                this -> words[w] &= rhs.words[w];
+            }
+            return *this;
+        }
+
+        // operator|=
+        // add the bits that are set in rhs; both sets must be the same size
+        Bitset& operator|=(const Bitset& rhs) {
+            for (size_t w = 0; w < this -> words.size(); ++w) {
+                this -> words[w] |= rhs.words[w];
+            }
+            return *this;
+        }
+
+        // andNot
+        // clear every bit that is set in rhs; both sets must be the same size
+        void andNot(const Bitset& rhs) {
+            for (size_t w = 0; w < this -> words.size(); ++w) {
+                this -> words[w] &= ~rhs.words[w];
+            }
+        }
+
+        // assignAndNot
+        // overwrite this set with lhs & ~rhs, reusing the existing buffer when
+        // it is large enough
+        void assignAndNot(const Bitset& lhs, const Bitset& rhs) {
+            this -> words.resize(lhs.words.size());
+            this -> nBits = lhs.nBits;
+            for (size_t w = 0; w < this -> words.size(); ++w) {
+                this -> words[w] = lhs.words[w] & ~rhs.words[w];
+            }
+        }
+
+        // intersects
+        // return whether any bit is set in both this set and rhs; both sets
+        // must be the same size
+        bool intersects(const Bitset& rhs) const {
+            for (size_t w = 0; w < this -> words.size(); ++w) {
+                if (this -> words[w] & rhs.words[w]) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // any
+        // return whether any bit is set
+        bool any() const {
+            for (uint64_t word: this -> words) {
+                if (word) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // anyInRange
+        // return whether any bit with an index in [begin, end) is set
+        bool anyInRange(size_t begin, size_t end) const {
+            if (begin >= end) {
+                return false;
+            }
+
+            size_t lastWord = (end - 1) / WORD_BITS;
+            for (size_t w = begin / WORD_BITS; w <= lastWord; ++w) {
+                if (this -> words[w] & rangeMask(w, begin, end)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // count
+        // the number of bits that are set
+        size_t count() const {
+            size_t n = 0;
+            for (uint64_t word: this -> words) {
+                n += (size_t)__builtin_popcountll(word);
+            }
+            return n;
+        }
+
+        // countInRange
+        // the number of bits with an index in [begin, end) that are set
+        size_t countInRange(size_t begin, size_t end) const {
+            if (begin >= end) {
+                return 0;
+            }
+
+            size_t n = 0;
+            size_t lastWord = (end - 1) / WORD_BITS;
+            for (size_t w = begin / WORD_BITS; w <= lastWord; ++w) {
+                n += (size_t)__builtin_popcountll(
+                    this -> words[w] & rangeMask(w, begin, end));
+            }
+            return n;
+        }
+
+        // operator==
+        // two sets are equal if they have the same size and bits
+        bool operator==(const Bitset& rhs) const {
+            return this -> nBits == rhs.nBits && this -> words == rhs.words;
+        }
+
+        // hash
+        // a hash of the bits, so that sets can be used as keys of hash tables
+        size_t hash() const {
+            uint64_t h = 14695981039346656037ULL;
+            for (uint64_t word: this -> words) {
+                h ^= word;
+                h *= 1099511628211ULL;
+                h ^= h >> 29;
+            }
+            return (size_t)h;
+        }
+
+        // display
+        // display the bits to an output stream, lowest index first
+        void display(std::ostream& os) const {
+            for (size_t i = 0; i < this -> nBits; ++i) {
+                os << (this -> test(i) ? '1' : '0');
+            }
+            os << std::endl;
+        }
+};
+
+#endif // BITSET_H
@@ -0,0 +1,194 @@
+
+#ifndef CONCURRENT_TOP_ELEMS_HEAP_H
+#define CONCURRENT_TOP_ELEMS_HEAP_H
+
+#include "TopElemsHeap.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <type_traits>
+#include <limits>
+
+// ConcurrentTopElemsHeap
+// A TopElemsHeap that many threads can push to at once. It is split into
+// shards, and each producer thread pushes to a shard of its own, which keeps
+// its own top maxElems elements. Whenever a shard is full, the key of its
+// lowest element is published as a shared threshold: at least maxElems
+// elements rank that high, so a value whose key is no higher can never make
+// it into the overall top elements, and producers reject it with a single
+// atomic load instead of taking any lock. The shards are merged on demand.
+// Keys must be something std::atomic can hold, such as a score
+template<class T, class Key = std::identity>
+class ConcurrentTopElemsHeap {
+    public:
+
+        // the type of key that elements are ranked by
+        typedef std::remove_cvref_t<std::invoke_result_t<Key&, const T&>> KeyType;
+
+        // Shard
+        // the part of the heap that one producer pushes to; a shard may only
+        // be pushed to from one thread at a time, but may be pushed to while
+        // the heap is being merged
+        class Shard {
+            private:
+                friend class ConcurrentTopElemsHeap;
+
+                // the heap the shard belongs to
+                ConcurrentTopElemsHeap * owner;
+
+                // the top elements pushed to this shard, and a lock that is
+                // only contended while the shards are being merged
+                TopElemsHeap<T, Key> heap;
+                mutable std::mutex lock;
+
+            public:
+
+                // constructor
+                Shard(ConcurrentTopElemsHeap * heapOwner) : owner(heapOwner),
+                    heap(heapOwner -> maxElems, heapOwner -> key), lock() {}
+
+                Shard(const Shard& rhs) = delete;
+                Shard& operator=(const Shard& rhs) = delete;
+
+                // push
+                // add a value to the shard, unless it cannot make it into
+                // the overall top elements
+                void push(const T& value) {
+                    if (this -> owner -> rejects(value)) {
+                        return;
+                    }
+                    T copy = value;
+                    this -> pushLocked(std::move(copy));
+                }
+
+                // push
+                // add a value to the shard, moving it instead of copying it
+                void push(T&& value) {
+                    if (this -> owner -> rejects(value)) {
+                        return;
+                    }
+                    this -> pushLocked(std::move(value));
+                }
+
+            private:
+
+                // pushLocked
+                // add a value to the shard's heap, and publish the shard's
+                // lowest key if the shard is full
+                void pushLocked(T&& value) {
+                    std::lock_guard<std::mutex> guard(this -> lock);
+                    this -> heap.push(std::move(value));
+
+                    const std::vector<T>& elems = this -> heap.getElements();
+                    if (elems.size() >= this -> owner -> maxElems) {
+                        this -> owner -> publish(
+                            std::invoke(this -> owner -> key, elems.front()));
+                    }
+                }
+        };
+
+    private:
+
+        // the number of elements kept
+        const size_t maxElems;
+
+        // the projection from an element to the key it is ranked by
+        Key key;
+
+        // the shards; they are not moved once created, since producers hold
+        // references to them
+        std::vector<std::unique_ptr<Shard>> shards;
+
+        // the highest key published by a full shard, and whether any shard
+        // has published one yet
+        std::atomic<KeyType> threshold;
+        std::atomic<bool> published;
+
+        // rejects
+        // whether a value can be dropped without looking at any shard
+        bool rejects(const T& value) const {
+            return this -> published.load(std::memory_order_acquire)
+                && !(std::invoke(this -> key, value)
+                > this -> threshold.load(std::memory_order_relaxed));
+        }
+
+        // publish
+        // raise the threshold to a shard's lowest key, if that is higher
+        void publish(const KeyType& lowest) {
+            KeyType current = this -> threshold.load(std::memory_order_relaxed);
+            while (lowest > current && !this -> threshold.compare_exchange_weak(
+                current, lowest, std::memory_order_relaxed)) {}
+            this -> published.store(true, std::memory_order_release);
+        }
+
+    public:
+
+        // constructor
+        ConcurrentTopElemsHeap(size_t n, size_t nShards,
+            Key projection = Key()) : maxElems(n), key(projection), shards(),
+            threshold(std::numeric_limits<KeyType>::lowest()), published(false) {
+
+            for (size_t i = 0; i < nShards; ++i) {
+                this -> shards.push_back(std::make_unique<Shard>(this));
+            }
+        }
+
+        ConcurrentTopElemsHeap(const ConcurrentTopElemsHeap& rhs) = delete;
+        ConcurrentTopElemsHeap& operator=(const ConcurrentTopElemsHeap& rhs)
+            = delete;
+
+        // getShard
+        // the shard with index i, which one producer should push to
+        Shard& getShard(size_t i) {
+            return *this -> shards[i];
+        }
+
+        // getNumShards
+        // the number of shards
+        size_t getNumShards() const {
+            return this -> shards.size();
+        }
+
+        // getSorted
+        // merge the shards into the overall top elements, highest ranked
+        // first, leaving the shards as they are; this may be called while
+        // producers are pushing
+        std::vector<T> getSorted() const {
+            TopElemsHeap<T, Key> merged(this -> maxElems, this -> key);
+            for (auto& shard: this -> shards) {
+                std::lock_guard<std::mutex> guard(shard -> lock);
+                const std::vector<T>& elems = shard -> heap.getElements();
+                merged.pushRange(elems.begin(), elems.end());
+            }
+            return merged.drainSorted();
+        }
+
+        // drainSorted
+        // merge the shards into the overall top elements, highest ranked
+        // first, and empty the heap; no producer may push while it runs
+        std::vector<T> drainSorted() {
+            TopElemsHeap<T, Key> merged(this -> maxElems, this -> key);
+            for (auto& shard: this -> shards) {
+                std::vector<T>& elems = shard -> heap.getMutElements();
+                merged.pushRange(std::make_move_iterator(elems.begin()),
+                    std::make_move_iterator(elems.end()));
+            }
+            this -> clear();
+            return merged.drainSorted();
+        }
+
+        // clear
+        // remove every element and reset the threshold; no producer may push
+        // while it runs
+        void clear() {
+            for (auto& shard: this -> shards) {
+                shard -> heap.clear();
+            }
+            this -> published.store(false, std::memory_order_relaxed);
+            this -> threshold.store(std::numeric_limits<KeyType>::lowest(),
+                std::memory_order_relaxed);
+        }
+};
+
+#endif // CONCURRENT_TOP_ELEMS_HEAP_H
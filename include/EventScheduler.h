@@ -6,31 +6,104 @@
 #include "Event.h"
 #include "SharedVector.h"
 #include "TopElemsHeap.h"
+#include "Bitset.h"
+#include "ScratchArena.h"
+#include "Metrics.h"
+#include "SoftObjective.h"
 #include <unordered_map>
 #include <unordered_set>
 #include <queue>
 #include <cstdint>
+#include <memory>
+#include <atomic>
 
 class EventScheduler {
+	public:
+
+		// a member of a choice group: the event, its id, and the weight that
+		// choosing it adds to a schedule
+		struct ChoiceMember {
+			Event event;
+			unsigned int id;
+			double weight;
+		};
+
+		// a component of a bundle, such as the lecture or the lab of a course
+		struct BundleComponent {
+			Event event;
+			unsigned int id;
+		};
+
+		// section `section` of component `component` of a bundle may be taken
+		// together with section `otherSection` of component `otherComponent`.
+		// Once any link is given between two components, only the linked
+		// pairs of their sections may be taken together
+		struct BundleLink {
+			unsigned int component;
+			unsigned int section;
+			unsigned int otherComponent;
+			unsigned int otherSection;
+		};
+
+		// the solver that autoSchedule picks, and the estimates it picks it
+		// by: the base 10 log of the number of nodes an exact search would
+		// visit, the share of pairs of sections of different events that
+		// conflict, and the width of the beam when the beam is picked
+		struct SolverChoice {
+			enum Solver { EXACT, GREEDY, BEAM } solver;
+			double logNodes;
+			double conflictDensity;
+			unsigned int width;
+		};
+
+		// a scheduler checked out of the calling thread's pool of idle
+		// schedulers by checkout; when the lease ends, the scheduler is reset
+		// and returned to the pool of the thread that ends it, keeping the
+		// capacity it grew, so that a thread serving many requests stops
+		// allocating once its schedulers are warm
+		class Lease {
+			private:
+				EventScheduler * sched;
+
+			public:
+				Lease(EventScheduler * leased);
+				Lease(Lease&& rhs) noexcept;
+				Lease(const Lease& rhs) = delete;
+				Lease& operator=(const Lease& rhs) = delete;
+				~Lease();
+
+				EventScheduler& operator*() const;
+				EventScheduler * operator->() const;
+		};
+
 	private:
 
 		// a unique idetifier for a particular section of an event 
 		typedef size_t SectionID;
 
 		// a collection of sections forms a schedule
-		typedef SharedVector<SectionID> Schedule;
+		typedef SharedVector<SectionID, 8> Schedule;
 
 		// A wrapper for schedules that make the comparable by associated
-		// weight
+		// score, the weight of their sections less the cost of the soft
+		// objectives; bound is an upper bound on the weight that the events not
+		// yet considered can still add, domain holds the sections that could
+		// still be added without creating a conflict, and week summarizes the
+		// sections so that the objectives can be updated in O(1)
 		struct ScheduleWrapper {
-			double weight;
+			double score;
+			double bound;
 			Schedule sched;
+			Bitset domain;
+			WeekOccupancy week;
 			
 			bool operator<(const ScheduleWrapper& rhs) const;
 			bool operator>(const ScheduleWrapper& rhs) const;
 			bool operator<=(const ScheduleWrapper& rhs) const;
 			bool operator>=(const ScheduleWrapper& rhs) const;
 			bool operator==(const ScheduleWrapper& rhs) const;
+
+			std::pair<double, double> rank() const;
 		};
 
 		// A wrapper for an event object which makes it comparable by an
@@ -39,6 +112,7 @@ class EventScheduler {
 			unsigned int id;
 			Event event;
 			double weight;
+			bool required;
 
 			bool operator<(const EventWrapper& rhs) const;
 			bool operator>(const EventWrapper& rhs) const;
@@ -48,19 +122,181 @@ class EventScheduler {
 		};
 
 		// a list of sections; you lookup a section based on its sectionID and
-		// get its event id and section index
+		// get its event id and section index, and the weight that choosing it
+		// adds to a schedule
 		struct SectionWrapper {
 			unsigned int eventID;
 			unsigned int sectionIndex;
 			const IntervalGroup * section;
+			double weight;
+		};
+
+		// an event as seen by a search: the largest weight of its sections and
+		// the range of section ids [begin, end) that belong to it. The sections
+		// of a choice group are those of all of its members. The components of
+		// a bundle are searched as consecutive events; component is the index
+		// of the event within its bundle and nComponents the size of the
+		// bundle, which is 1 for events that are not part of a bundle
+		struct SearchEvent {
+			unsigned int id;
+			double weight;
+			SectionID begin;
+			SectionID end;
+			bool required;
+			unsigned int component;
+			unsigned int nComponents;
+		};
+
+		// the events in the order in which a search branches on them, and for
+		// every section the positions in that order of the events that have at
+		// least one section conflicting with it. Required events always come
+		// first, so the first nRequired events are the required ones
+		struct SearchOrder {
+			std::vector<SearchEvent> events;
+			std::vector<std::vector<size_t>> touched;
+			size_t nRequired;
+		};
+
+		// the state that the solvers of a portfolio build share: the score of
+		// the best schedule any of them has found, which every solver prunes
+		// with, and whether they should stop
+		struct Incumbent {
+			std::atomic<double> score;
+			std::atomic<bool> stop;
+
+			Incumbent();
+		};
+
+		// The best schedules found by a search, kept in order of decreasing
+		// score; at most maxSchedules are kept, and no two of them differ in
+		// fewer than minDiff sections. Searches offer every schedule they come
+		// across, and can cut any branch that cannot beat threshold()
+		class SchedulePool {
+			private:
+				struct Entry {
+					double score;
+					std::vector<SectionID> sched;
+					std::vector<SectionID> sorted;
+				};
+
+				size_t maxSchedules;
+				unsigned int minDiff;
+				std::vector<Entry> entries;
+				Incumbent * shared;
+
+				unsigned int distance(const std::vector<SectionID>& lhs,
+					const std::vector<SectionID>& rhs) const;
+
+			public:
+				SchedulePool(size_t k = 1, unsigned int minDifference = 1);
+				SchedulePool(const SchedulePool& rhs) = default;
+				SchedulePool& operator=(const SchedulePool& rhs) = default;
+
+				void share(Incumbent * incumbent);
+				bool stopped() const;
+
+				double threshold() const;
+				bool offer(double score, const std::vector<SectionID>& sched);
+
+				size_t size() const;
+				double getScore(size_t index) const;
+				const std::vector<SectionID>& getSchedule(size_t index) const;
+		};
+
+		// a memoized result of the time indexed dynamic program: the largest
+		// weight the remaining events can add for a given weekly occupancy, and
+		// the section that achieves it (NO_SECTION to leave the event out)
+		struct SlotEntry {
+			double weight;
+			SectionID choice;
+		};
+
+		// hashes occupancy masks so that they can key the memoization tables
+		struct BitsetHash {
+			size_t operator()(const Bitset& bits) const;
 		};
 
+		typedef std::unordered_map<Bitset, SlotEntry, BitsetHash> SlotTable;
+
+		static constexpr SectionID NO_SECTION = SIZE_MAX;
+
+		// the most events that are searched exactly around each schedule of
+		// the previous build when warm starting
+		static constexpr size_t WARM_START_MAX_FREE = 12;
+
 		SectionID getSectionID(unsigned int eventID, unsigned int sectionIndex) const;
 
+		bool isExcluded(const IntervalGroup& section) const;
+
+		void linkBundle(unsigned int id, size_t nBuilt);
+
+		bool bundleFits(const SearchOrder& order, size_t depth,
+			const Bitset& domain) const;
+
+		unsigned int searchEventID(unsigned int eventID) const;
+
+		void addSections(unsigned int eventID, double weight);
+
+		void eraseSections(const Bitset& drop);
+
 		bool sectionConflictsWithSchedule(Schedule& sched, SectionID sec) const;
 
 		void buildConflicts();
 
+		std::vector<SearchEvent> listSearchEvents() const;
+
+		SearchOrder buildSearchOrder(
+			const std::vector<SearchEvent>& searchEvents) const;
+
+		ScheduleWrapper makeRootSchedule(const SearchOrder& order) const;
+
+		double lostBound(const SearchOrder& order, size_t depth,
+			const Bitset& before, const Bitset& after, SectionID sec) const;
+
+		double addToWeek(WeekOccupancy& week, SectionID sec) const;
+
+		double recoverable(const WeekOccupancy& week) const;
+
+		void searchExact(const SearchOrder& order, size_t depth,
+			double score, double bound, const WeekOccupancy& week,
+			std::vector<Bitset>& domains, std::vector<SectionID>& path,
+			SchedulePool& pool) const;
+
+		size_t adaptWidth(const SearchOrder& order, size_t depth,
+			const std::pmr::vector<ScheduleWrapper>& candidates,
+			size_t nEvaluated, size_t workDone, unsigned int maxWidth) const;
+
+		std::vector<std::vector<SectionID>> beamSearch(const SearchOrder& order,
+			unsigned int maxConsidered, SchedulePool& pool,
+			double& upperBound) const;
+
+		bool buildSlotMasks(const std::vector<SearchEvent>& searchEvents,
+			size_t maxSlots, std::vector<Bitset>& masks) const;
+
+		double searchSlots(const std::vector<SearchEvent>& searchEvents,
+			const std::vector<Bitset>& masks,
+			const std::vector<Bitset>& futureSlots, size_t depth,
+			const Bitset& occupied, std::vector<SlotTable>& memo) const;
+
+		void searchAround(const std::vector<SearchEvent>& searchEvents,
+			const std::unordered_map<unsigned int, size_t>& position,
+			const std::vector<SectionID>& fixedSections, size_t maxFree,
+			SchedulePool& pool) const;
+
+		void improveSchedule(const std::vector<SearchEvent>& searchEvents,
+			SchedulePool& pool) const;
+
+		void extendSchedules(const std::vector<SearchEvent>& searchEvents,
+			SchedulePool& pool) const;
+
+		void fitRequired(const SearchOrder& order, SchedulePool& pool) const;
+
+		std::vector<std::pair<unsigned int, unsigned int>> toResult(
+			const std::vector<SectionID>& sched) const;
+
+		std::vector<std::vector<std::pair<unsigned int, unsigned int>>> toResults(
+			const SchedulePool& pool) const;
+
 		// priority queue for maintaining the order in which events should
 		// be attempted to be added to the schedule
 		//std::priority_queue<EventWrapper> eventsToSchedule;
@@ -73,20 +309,114 @@ class EventScheduler {
 		// vector fo looking up the section
 		std::vector<SectionWrapper> sections;
 
-		// a mapping from event ids to their locations in the sections list
-		std::unordered_map<unsigned int, size_t> eventSectionsStartIndex;
+		// a mapping from event ids to the range [first, second) of the
+		// sections list that holds their sections
+		std::unordered_map<unsigned int, std::pair<SectionID, SectionID>>
+			eventSectionRanges;
+
+		// the members of each choice group, and the group of each member; the
+		// sections of a group's members are stored together under the group
+		std::unordered_map<unsigned int, std::vector<unsigned int>>
+			choiceGroupMembers;
+		std::unordered_map<unsigned int, unsigned int> choiceGroupOf;
+
+		// the components of each bundle, in the order they are searched, and
+		// the section pairs of its components that may be taken together
+		std::unordered_map<unsigned int, std::vector<unsigned int>>
+			bundleComponents;
+		std::unordered_map<unsigned int, std::vector<BundleLink>> bundleLinks;
+
+		// the times that no section may overlap, with overlapping windows
+		// merged; sections that overlap them are never added to the sections
+		// list, so they take no part in the conflicts graph or any search
+		std::vector<std::pair<double, double>> exclusionTimes;
+		IntervalGroup exclusions;
+
+		// the soft objectives and the weight of each; a schedule scores the
+		// weight of its sections less the weighted cost of the objectives.
+		// dayLength is the length of a day in the units of the sections' times
+		std::vector<std::pair<std::shared_ptr<const SoftObjective>, double>>
+			objectives;
+		double dayLength;
 
 		// adjacency matrix of conflicts between sections; sections are
-		std::vector<std::vector<bool>> conflicts;
+		// considered to conflict with themselves. It is built lazily, so it
+		// may only cover the sections at the start of the sections list.
+		// Rows dropped by reset are kept as spares, and reused by later rows
+		std::vector<Bitset> conflicts;
+		std::vector<Bitset> spareConflicts;
 
 		// maximum number of sections considered per event
 		unsigned int maxSecPerEvent;
 
+		// settings for the improvement phase run after the beam search: the
+		// number of rounds (0 disables it), the number of events freed each
+		// round, a time limit in milliseconds (0 for none), and the seed used
+		// to pick the events that are freed
+		unsigned int improveIterations;
+		unsigned int improveNeighbourhood;
+		double improveTimeLimit;
+		unsigned int improveSeed;
+
+		// settings for the adaptive beam width: the number of candidate
+		// schedules the beam may evaluate (0 for a fixed width), and the
+		// number of schedules it tries to keep alive every round
+		size_t adaptiveBudget;
+		unsigned int adaptiveMinWidth;
+
+		// settings for autoSchedule: the largest estimate of the log of the
+		// nodes an exact search visits for which it is picked, and the number
+		// of candidate schedules a beam it picks may evaluate; and the last
+		// choice it made
+		double autoExactLimit;
+		size_t autoBeamWork;
+		SolverChoice solverChoice;
+
+		// whether the last build found a schedule with every required event
+		bool feasible;
+
+		// whether the last build is known to have found the best schedules,
+		// and if not, how much better a schedule it missed could be
+		bool optimal;
+		double optimalityGap;
+
+		// whether approximate builds start from the schedules of the previous
+		// build, and those schedules as (event id, section index) pairs so
+		// that they survive events being added and removed
+		bool warmStart;
+		std::vector<std::vector<std::pair<unsigned int, unsigned int>>>
+			warmSchedules;
+
 	public:
 		EventScheduler(unsigned int maxEvents=50,
 			unsigned int maxSectionsPerEvent=20);
+
+		static Lease checkout(unsigned int maxEvents=50,
+			unsigned int maxSectionsPerEvent=20);
 		
-		void addEvent(const Event& event, unsigned int id, double weight = 1.0);
+		void addEvent(const Event& event, unsigned int id, double weight = 1.0,
+			bool required = false);
+		void addChoiceGroup(const std::vector<ChoiceMember>& members,
+			unsigned int id, bool required = false);
+		void addBundle(const std::vector<BundleComponent>& components,
+			const std::vector<BundleLink>& links, unsigned int id,
+			double weight = 1.0, bool required = false);
+		void removeEvent(unsigned int id);
+		void reset();
+		void addExclusion(const IntervalGroup& times);
+		void addObjective(std::shared_ptr<const SoftObjective> objective,
+			double weight = 1.0);
+		void setDayLength(double length);
+
+		void setImprovementPhase(unsigned int iterations,
+			unsigned int neighbourhoodSize = 3, double timeLimitMs = 0,
+			unsigned int seed = 0);
+		void setWarmStart(bool enabled);
+		void setAdaptiveBeam(size_t workBudget, unsigned int minWidth = 8);
+		void setAutoThresholds(double maxExactLogNodes, size_t beamWork);
+		bool isFeasible() const;
+		bool isOptimal() const;
+		double getOptimalityGap() const;
 
 		void display(std::ostream& os) const;
 
@@ -94,6 +424,20 @@ class EventScheduler {
 			buildOptimalSchedule();
 		std::vector<std::pair<unsigned int, unsigned int>> buildApproxSchedule(
 			unsigned int maxConsidered = 500);
+		std::vector<std::pair<unsigned int, unsigned int>> buildSlotSchedule(
+			size_t maxSlots = 128);
+		std::vector<std::pair<unsigned int, unsigned int>> buildPortfolioSchedule(
+			double deadlineMs, unsigned int maxConsidered = 500);
+
+		SolverChoice chooseSolver();
+		const SolverChoice& getSolverChoice() const;
+		std::vector<std::pair<unsigned int, unsigned int>> autoSchedule();
+
+		std::vector<std::vector<std::pair<unsigned int, unsigned int>>>
+			buildOptimalSchedules(size_t k, unsigned int minDiff = 1);
+		std::vector<std::vector<std::pair<unsigned int, unsigned int>>>
+			buildApproxSchedules(size_t k, unsigned int minDiff = 1,
+			unsigned int maxConsidered = 500);
 };
 
 #endif // EVENT_SCHEDULER_H
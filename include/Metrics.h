@@ -0,0 +1,244 @@
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+// LatencyHistogram
+// A count of operations and a histogram of how long they took, in
+// nanoseconds. Buckets are log-linear, as in HDR histograms: every power of
+// two is split into SUB_BUCKETS equal buckets, so any latency is known to
+// within about 6% while the whole range of 64-bit values takes under a
+// thousand counters. Recording is a few relaxed atomic increments and takes
+// no lock, so any thread may record at any time; readers see a consistent
+// enough picture for reporting, not an exact snapshot
+class LatencyHistogram {
+    private:
+        static const unsigned int SUB_BITS = 4;
+        static const uint64_t SUB_BUCKETS = (uint64_t)1 << SUB_BITS;
+        static const size_t N_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+        std::array<std::atomic<uint64_t>, N_BUCKETS> buckets;
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> total;
+        std::atomic<uint64_t> largest;
+
+        // bucketOf
+        // the index of the bucket that holds value; values below SUB_BUCKETS
+        // get a bucket each
+        static size_t bucketOf(uint64_t value) {
+            if (value < SUB_BUCKETS) {
+                return (size_t)value;
+            }
+            unsigned int exponent = 63 - (unsigned int)__builtin_clzll(value);
+            uint64_t sub = (value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1);
+            return (size_t)((exponent - SUB_BITS + 1) * SUB_BUCKETS + sub);
+        }
+
+        // lowestOf
+        // the smallest value that falls in a bucket
+        static uint64_t lowestOf(size_t bucket) {
+            if (bucket < SUB_BUCKETS) {
+                return bucket;
+            }
+            unsigned int exponent = (unsigned int)(bucket / SUB_BUCKETS)
+                + SUB_BITS - 1;
+            uint64_t sub = bucket % SUB_BUCKETS;
+            return (SUB_BUCKETS + sub) << (exponent - SUB_BITS);
+        }
+
+    public:
+
+        // constructor
+        LatencyHistogram() : buckets(), count(0), total(0), largest(0) {
+            for (auto& bucket: this -> buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        LatencyHistogram(const LatencyHistogram& rhs) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram& rhs) = delete;
+
+        // record
+        // add an operation that took nanos nanoseconds
+        void record(uint64_t nanos) {
+            this -> buckets[bucketOf(nanos)].fetch_add(1,
+                std::memory_order_relaxed);
+            this -> count.fetch_add(1, std::memory_order_relaxed);
+            this -> total.fetch_add(nanos, std::memory_order_relaxed);
+
+            uint64_t seen = this -> largest.load(std::memory_order_relaxed);
+            while (nanos > seen && !this -> largest.compare_exchange_weak(seen,
+                nanos, std::memory_order_relaxed)) {}
+        }
+
+        // getCount
+        // the number of operations recorded
+        uint64_t getCount() const {
+            return this -> count.load(std::memory_order_relaxed);
+        }
+
+        // getMean
+        // the mean latency in nanoseconds, or 0 if nothing was recorded
+        double getMean() const {
+            uint64_t n = this -> getCount();
+            return n == 0 ? 0
+                : (double)this -> total.load(std::memory_order_relaxed)
+                / (double)n;
+        }
+
+        // getMax
+        // the largest latency recorded, in nanoseconds
+        uint64_t getMax() const {
+            return this -> largest.load(std::memory_order_relaxed);
+        }
+
+        // getPercentile
+        // the latency in nanoseconds that a share p (from 0 to 1) of the
+        // operations took at most, up to the precision of the buckets
+        uint64_t getPercentile(double p) const {
+            uint64_t n = this -> getCount();
+            if (n == 0) {
+                return 0;
+            }
+            uint64_t rank = (uint64_t)(p * (double)n);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < N_BUCKETS; ++i) {
+                seen += this -> buckets[i].load(std::memory_order_relaxed);
+                if (seen > rank) {
+                    uint64_t highest = i + 1 < N_BUCKETS
+                        ? lowestOf(i + 1) - 1 : UINT64_MAX;
+                    return std::min(highest, this -> getMax());
+                }
+            }
+            return this -> getMax();
+        }
+
+        // reset
+        // forget every operation recorded
+        void reset() {
+            for (auto& bucket: this -> buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            this -> count.store(0, std::memory_order_relaxed);
+            this -> total.store(0, std::memory_order_relaxed);
+            this -> largest.store(0, std::memory_order_relaxed);
+        }
+};
+
+// Metrics
+// A registry of latency histograms by operation name, such as "search" or
+// "scheduler.conflicts". Looking a histogram up takes a lock, so call sites
+// look theirs up once and keep the reference, which stays valid for the life
+// of the program; after that, timing an operation costs two clock reads and
+// a few atomic increments, and nothing is printed unless dump is called
+class Metrics {
+    private:
+        mutable std::mutex lock;
+        std::map<std::string, std::unique_ptr<LatencyHistogram>> histograms;
+
+    public:
+
+        // constructor
+        Metrics() : lock(), histograms() {}
+
+        Metrics(const Metrics& rhs) = delete;
+        Metrics& operator=(const Metrics& rhs) = delete;
+
+        // global
+        // the registry that the library records to
+        static Metrics& global() {
+            static Metrics registry;
+            return registry;
+        }
+
+        // histogram
+        // the histogram of the named operation, created empty the first time
+        LatencyHistogram& histogram(const std::string& name) {
+            std::lock_guard<std::mutex> guard(this -> lock);
+            auto& found = this -> histograms[name];
+            if (!found) {
+                found = std::make_unique<LatencyHistogram>();
+            }
+            return *found;
+        }
+
+        // getNames
+        // the names of every operation with a histogram, in order
+        std::vector<std::string> getNames() const {
+            std::lock_guard<std::mutex> guard(this -> lock);
+            std::vector<std::string> names;
+            for (auto& named: this -> histograms) {
+                names.push_back(named.first);
+            }
+            return names;
+        }
+
+        // reset
+        // forget every operation recorded, keeping the histograms
+        void reset() {
+            std::lock_guard<std::mutex> guard(this -> lock);
+            for (auto& named: this -> histograms) {
+                named.second -> reset();
+            }
+        }
+
+        // dump
+        // write the count and latencies of every operation that was recorded,
+        // in microseconds
+        void dump(std::ostream& os) const {
+            std::lock_guard<std::mutex> guard(this -> lock);
+            os << std::left << std::setw(28) << "operation" << std::right
+                << std::setw(10) << "count" << std::setw(12) << "mean us"
+                << std::setw(12) << "p50 us" << std::setw(12) << "p99 us"
+                << std::setw(12) << "max us" << "\n";
+            for (auto& [name, histogram]: this -> histograms) {
+                if (histogram -> getCount() == 0) {
+                    continue;
+                }
+                os << std::left << std::setw(28) << name << std::right
+                    << std::setw(10) << histogram -> getCount() << std::fixed
+                    << std::setprecision(1)
+                    << std::setw(12) << histogram -> getMean() / 1000
+                    << std::setw(12) << (double)histogram -> getPercentile(0.5) / 1000
+                    << std::setw(12) << (double)histogram -> getPercentile(0.99) / 1000
+                    << std::setw(12) << (double)histogram -> getMax() / 1000
+                    << std::defaultfloat << "\n";
+            }
+            os.flush();
+        }
+};
+
+// ScopedLatency
+// records how long it lived, from construction to destruction, to a histogram
+class ScopedLatency {
+    private:
+        LatencyHistogram& histogram;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        ScopedLatency(LatencyHistogram& target) : histogram(target),
+            start(std::chrono::steady_clock::now()) {}
+
+        ScopedLatency(const ScopedLatency& rhs) = delete;
+        ScopedLatency& operator=(const ScopedLatency& rhs) = delete;
+
+        ~ScopedLatency() {
+            auto elapsed = std::chrono::steady_clock::now() - this -> start;
+            this -> histogram.record((uint64_t)std::chrono::duration_cast<
+                std::chrono::nanoseconds>(elapsed).count());
+        }
+};
+
+#endif // METRICS_H
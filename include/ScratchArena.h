@@ -0,0 +1,142 @@
+
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <memory_resource>
+#include <optional>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+// ScratchArena
+// A monotonic memory resource for the short lived objects of one build: memory
+// is handed out by bumping a pointer, never freed on its own, and all released
+// at once by reset when the build is done. The arena keeps its buffer between
+// builds, and grows it to fit the largest build so far (up to maxRetained
+// bytes), so that once warmed up a thread's builds allocate nothing from the
+// heap. Each thread has an arena of its own, from local, so arenas need no
+// locking; an arena must only be used by the thread it belongs to
+class ScratchArena : public std::pmr::memory_resource {
+    private:
+
+        // the buffer the arena hands out first, and the arena over it, which
+        // falls back to upstream once the buffer is used up
+        std::vector<std::byte> buffer;
+        std::pmr::memory_resource * upstream;
+        std::optional<std::pmr::monotonic_buffer_resource> arena;
+
+        // the bytes handed out since the last reset, and the most handed out
+        // between any two resets
+        size_t used;
+        size_t peak;
+
+        // the largest buffer kept between builds
+        size_t maxRetained;
+
+        // the number of scopes that are using the arena
+        unsigned int nScopes;
+
+        void * do_allocate(size_t bytes, size_t alignment) override {
+            this -> used += bytes;
+            return this -> arena -> allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *, size_t, size_t) override {}
+
+        bool do_is_equal(const std::pmr::memory_resource& other)
+            const noexcept override {
+
+            return this == &other;
+        }
+
+    public:
+
+        // Scope
+        // the lifetime of one build's scratch objects; the arena is reset when
+        // the outermost scope ends, so a scope must be created before, and
+        // end after, every object allocated from the arena
+        class Scope {
+            private:
+                ScratchArena& owner;
+
+            public:
+                Scope(ScratchArena& scratch) : owner(scratch) {
+                    this -> owner.nScopes += 1;
+                }
+
+                Scope(const Scope& rhs) = delete;
+                Scope& operator=(const Scope& rhs) = delete;
+
+                ~Scope() {
+                    this -> owner.nScopes -= 1;
+                    if (this -> owner.nScopes == 0) {
+                        this -> owner.reset();
+                    }
+                }
+        };
+
+        // constructor
+        ScratchArena(size_t initialBytes = 1 << 16,
+            size_t maxRetainedBytes = 1 << 26) :
+            buffer(initialBytes),
+            upstream(std::pmr::new_delete_resource()),
+            arena(),
+            used(0),
+            peak(0),
+            maxRetained(maxRetainedBytes),
+            nScopes(0) {
+
+            this -> arena.emplace(this -> buffer.data(), this -> buffer.size(),
+                this -> upstream);
+        }
+
+        ScratchArena(const ScratchArena& rhs) = delete;
+        ScratchArena& operator=(const ScratchArena& rhs) = delete;
+
+        // local
+        // the arena of the calling thread
+        static ScratchArena& local() {
+            static thread_local ScratchArena threadArena;
+            return threadArena;
+        }
+
+        // reset
+        // release everything allocated from the arena at once; if the build
+        // did not fit in the buffer, the buffer is grown for the next one
+        void reset() {
+            this -> peak = std::max(this -> peak, this -> used);
+            if (this -> used > this -> buffer.size()
+                && this -> buffer.size() < this -> maxRetained) {
+
+                this -> arena.reset();
+                this -> buffer = std::vector<std::byte>(std::min(
+                    this -> used + this -> used / 4, this -> maxRetained));
+                this -> arena.emplace(this -> buffer.data(),
+                    this -> buffer.size(), this -> upstream);
+            }
+            else {
+                this -> arena -> release();
+            }
+            this -> used = 0;
+        }
+
+        // getBytesUsed
+        // the bytes handed out since the last reset
+        size_t getBytesUsed() const {
+            return this -> used;
+        }
+
+        // getPeakBytes
+        // the most bytes handed out between two resets
+        size_t getPeakBytes() const {
+            return std::max(this -> peak, this -> used);
+        }
+
+        // getCapacity
+        // the size of the buffer kept between builds
+        size_t getCapacity() const {
+            return this -> buffer.size();
+        }
+};
+
+#endif // SCRATCH_ARENA_H
@@ -2,35 +2,16 @@
 #define SEARCHENGINE_H
 
 #include <TopElemsHeap.h>
+#include <Metrics.h>
 #include <iostream>
 #include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
-#include <chrono>
 #include <string>
 #include <vector>
 #include <cmath>
-
-/**
- *  @class A simple class that prints to standard out when it is destroyed.
- */
-struct Timer
-{
-    std::chrono::high_resolution_clock::time_point start;
-    std::string tag;
-
-    Timer(const std::string& p_tag) : start(), tag(p_tag)
-    {
-        start = std::chrono::high_resolution_clock::now();
-    }
-
-    virtual ~Timer()
-    {
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-        std::cout << "" << tag << " took about " << duration.count() << " µs." << std::endl;
-    }
-};
+#include <cstdint>
+#include <utility>
 
 template<typename DataType>
 class SearchEngine
@@ -38,6 +19,17 @@ class SearchEngine
     /* ---------------------------------------------------------------- */
 public:
 
+    /**
+     *  @brief A trigram, its three characters packed into an integer.
+     */
+    typedef uint32_t TermID;
+
+    /**
+     *  @brief A sparse vector of term weights, as {term, weight} pairs
+     *         sorted by term.
+     */
+    typedef std::vector<std::pair<TermID, double>> TermVector;
+
     /**
      *  @struct SearchEntry
      *  @brief To hold internal information and also returned upon search.
@@ -60,15 +52,17 @@ public:
      */
     struct IndexedEntry : public SearchEntry
     {
-        std::unordered_map<std::string, double> tf;
-        std::unordered_map<std::string, double> tfidf;
+        TermVector tf;
+        double norm;
+        size_t norm_epoch;
+        bool live;
 
         IndexedEntry()
-            : SearchEntry(), tf(), tfidf() {}
+            : SearchEntry(), tf(), norm(0), norm_epoch(0), live(false) {}
         IndexedEntry(
             const std::string& p_name,
             const DataType& p_data)
-            : SearchEntry(p_name, p_data), tf(), tfidf()
+            : SearchEntry(p_name, p_data), tf(), norm(0), norm_epoch(0), live(true)
         {
             // We want to compare by lower-case, so let's do that.
             std::string l_name = SearchEntry::name;
@@ -108,47 +102,71 @@ public:
 private:
 
     /**
-     *  @brief To hold all added documents.
+     *  @brief To hold all added documents; erased documents stay in place,
+     *         marked as not live, so that the ids of the others hold.
      */
     std::vector<IndexedEntry> docs;
+    size_t n_live;
 
     /**
-     *  @brief To hold occurrence of terms in all documents, and to
-     *         hold inverse document frequency of all terms in corpus.
+     *  @brief To hold occurrence of terms in all live documents.
      */
-    std::unordered_map<std::string, size_t> occ;
-    std::unordered_map<std::string, double> idf;
+    std::unordered_map<TermID, size_t> occ;
+
+    /**
+     *  @brief To hold, for every term, the live documents it occurs in
+     *         and its frequency in each, as pairs of {doc index, tf}.
+     *         Inverse document frequencies change with every insert, so
+     *         they are applied at query time instead of being stored.
+     */
+    std::unordered_map<TermID, std::vector<std::pair<size_t, double>>> postings;
+
+    /**
+     *  @brief Counts changes to the corpus; a document's norm depends on
+     *         the idf of its terms, so it is recomputed when it is next
+     *         needed if the corpus changed since it was computed.
+     */
+    size_t epoch;
+
+    /**
+     *  @brief Scratch space for search: the dot product of every indexed
+     *         document with the query, and the documents it is non-zero for.
+     */
+    std::vector<double> dots;
+    std::vector<size_t> touched;
 
     /**
      *  @brief Makes the normalized term frequencies for a given string.
      *  @param s The string to make the term frequencies for.
-     *  @param len The length of how to n-gram the string.
-     *  @return Unordered map of form {term: count, ...}
+     *  @param normalize Whether to divide the counts by the number of terms.
+     *  @return Sparse vector of form {{term, count}, ...}
      */
-    static std::unordered_map<std::string, double> make_tf(
+    static TermVector make_tf(
         const std::string& s,
-        const size_t& len = 3,
         bool normalize = true
     ) {
-        std::unordered_map<std::string, double> ret;
-        size_t total = 0;
-
-        // Count frequency of each word.
-        for (const std::string& ngram : make_ngrams(s, len)) {
-            ++ret[ngram];
-            ++total;
+        TermVector ret;
+
+        // Count frequency of each term by sorting them.
+        std::vector<TermID> ngrams = make_ngrams(s);
+        std::sort(ngrams.begin(), ngrams.end());
+        for (TermID ngram : ngrams) {
+            if (ret.empty() || ret.back().first != ngram) {
+                ret.push_back({ ngram, 0.0 });
+            }
+            ++ret.back().second;
         }
 
         // This can occur if query string is empty.
-        if (total == 0) {
+        if (ngrams.empty()) {
             return ret;
         }
 
         // Now, we will normalize the frequencies.
         if (normalize) {
-            double d_total = (double)total;
-            for (const auto& [ngram, _] : ret) {
-                ret[ngram] /= d_total;
+            double d_total = (double)ngrams.size();
+            for (auto& [_, freq] : ret) {
+                freq /= d_total;
             }
         }
 
@@ -156,38 +174,37 @@ private:
     }
 
     /**
-     *  @brief Make n-grams out of a given string.
+     *  @brief Make trigrams out of a given string, packing the characters
+     *         of each into an integer instead of copying them out.
      *  @param s The given string.
-     *  @param len The length of the n-grams.
-     *  @return The n-grams of @p s .
+     *  @return The trigrams of @p s .
      */
-    static std::vector<std::string> make_ngrams(
-        const std::string& s,
-        const size_t& len = 3
-    ) {
-        std::vector<std::string> ret;
+    static std::vector<TermID> make_ngrams(const std::string& s)
+    {
+        std::vector<TermID> ret;
 
         // Pad with " " on either side, then make chunks.
-        std::string pad = " " + s + " ";
-        for (size_t i = 0; i + len <= pad.size(); ++i) {
-            ret.push_back(pad.substr(i, len));
+        auto padded = [&s](size_t i) -> TermID {
+            return (i == 0 || i > s.size()) ? (TermID)' ' : (TermID)(unsigned char)s[i - 1];
+        };
+        for (size_t i = 0; i + 3 <= s.size() + 2; ++i) {
+            ret.push_back(padded(i) << 16 | padded(i + 1) << 8 | padded(i + 2));
         }
 
         return ret;
     }
 
     /**
-     *  @brief Calculate the magnitude of the values of an unordered_map.
-     *  @param map The unordered_map.
-     *  @return A double representing the magnitude of the @p map .
+     *  @brief Calculate the magnitude of the weights of a sparse vector.
+     *  @param vec The sparse vector.
+     *  @return A double representing the magnitude of the @p vec .
      */
-    template<typename T>
-    static double map_magnitude(const std::unordered_map<T, double>& map)
+    static double magnitude(const TermVector& vec)
     {
         double res = 0;
 
         // Square each value.
-        for (const auto& [_, b] : map) {
+        for (const auto& [_, b] : vec) {
             res += (double)(b * b);
         }
 
@@ -198,32 +215,73 @@ private:
     }
 
     /**
-     *  @brief Calculate cosine silarity between two unordered maps.
-     *  @param map1 The first unordered_map.
-     *  @param map2 The second unordered_map.
-     *  @return The cosine similarity between @p map1 and @p map2 .
+     *  @brief The inverse document frequency of a term in the live documents.
+     *  @param count The number of live documents the term occurs in.
+     *  @return The idf of the term.
      */
-    static double cosine_similarity(
-        const std::unordered_map<std::string, double>& map1,
-        const std::unordered_map<std::string, double>& map2
-    ) {
-        double ret = 0.0;
-
-        double mag1 = map_magnitude(map1);
-        double mag2 = map_magnitude(map2);
-        double mag = mag1 + mag2;
+    double term_idf(size_t count) const
+    {
+        return 1 + std::log((double)n_live / (double)count);
+    }
 
-        if (mag == 0) {
-            return ret;
+    /**
+     *  @brief The tfidf magnitude of a document, recomputed only if the
+     *         corpus changed since it was last computed.
+     *  @param entry The document.
+     *  @return The magnitude of the tfidf of @p entry .
+     */
+    double norm_of(IndexedEntry& entry)
+    {
+        if (entry.norm_epoch != epoch) {
+            double norm = 0;
+            for (const auto& [ngram, freq] : entry.tf) {
+                double tfidf = freq * term_idf(occ.at(ngram));
+                norm += tfidf * tfidf;
+            }
+            entry.norm = std::sqrt(norm);
+            entry.norm_epoch = epoch;
         }
+        return entry.norm;
+    }
 
-        for (const auto& [key, freq] : map1) {
-            ret += freq * ((map2.find(key) != map2.end()) ? map2.at(key) : 0.0);
+    /**
+     *  @brief Adds the terms of a live document to the occurrence counts
+     *         and posting lists.
+     *  @param doc The index of the document.
+     */
+    void add_terms(size_t doc)
+    {
+        for (const auto& [ngram, freq] : docs[doc].tf) {
+            ++occ[ngram];
+            postings[ngram].push_back({ doc, freq });
         }
+        ++n_live;
+        ++epoch;
+    }
 
-        ret /= mag;
-
-        return ret;
+    /**
+     *  @brief Removes the terms of a document from the occurrence counts
+     *         and posting lists, if it is live.
+     *  @param doc The index of the document.
+     */
+    void remove_terms(size_t doc)
+    {
+        if (!docs[doc].live) {
+            return;
+        }
+        for (const auto& [ngram, _] : docs[doc].tf) {
+            if (--occ[ngram] == 0) {
+                occ.erase(ngram);
+                postings.erase(ngram);
+            } else {
+                auto& list = postings[ngram];
+                list.erase(std::find_if(list.begin(), list.end(),
+                    [doc](const auto& posting) { return posting.first == doc; }));
+            }
+        }
+        docs[doc].live = false;
+        --n_live;
+        ++epoch;
     }
 
     /* ---------------------------------------------------------------- */
@@ -233,7 +291,7 @@ public:
      *  @brief Default constructor. Nothing special.
      */
     SearchEngine()
-        : docs(), occ(), idf() {}
+        : docs(), n_live(0), occ(), postings(), epoch(1), dots(), touched() {}
 
     /**
      *  @brief Clears internal state, deletes all entries and indexing.
@@ -241,26 +299,50 @@ public:
     void clear()
     {
         docs.clear();
+        n_live = 0;
         occ.clear();
-        idf.clear();
+        postings.clear();
+        ++epoch;
+        dots.clear();
+        touched.clear();
     }
 
     /**
      *  @brief Adds a name and its associated data to the search engine.
-     *         Increments occurrence count for all documents.
+     *         The entry can be searched for right away.
      *  @param name The name of the entry.
      *  @param data The data to associate with the entry.
+     *  @return The id of the entry, for updating or erasing it.
      */
-    void insert(std::string name, DataType data)
+    size_t insert(std::string name, DataType data)
     {
-        IndexedEntry entry = { name, data };
+        docs.push_back({ name, data });
+        dots.push_back(0);
+        add_terms(docs.size() - 1);
+        return docs.size() - 1;
+    }
 
-        // Update occurrence count for all documents.
-        for (const auto& [ngram, _] : entry.tf) {
-            ++occ[ngram];
-        }
+    /**
+     *  @brief Changes the name and data of an entry, or brings back an
+     *         erased entry under the same id.
+     *  @param id The id returned by insert.
+     *  @param name The new name of the entry.
+     *  @param data The new data to associate with the entry.
+     */
+    void update(size_t id, std::string name, DataType data)
+    {
+        remove_terms(id);
+        docs[id] = { name, data };
+        add_terms(id);
+    }
 
-        docs.push_back(entry);
+    /**
+     *  @brief Removes an entry from the search engine; its id is not reused.
+     *  @param id The id returned by insert.
+     */
+    void erase(size_t id)
+    {
+        remove_terms(id);
     }
 
     /**
@@ -273,9 +355,9 @@ public:
         double threshold = 0.01,
         size_t max_results = 50
     ) {
-        // Start timer.
-        std::string tag = "Search for '" + query + "'";
-        Timer timer(tag);
+        // Record how long the search takes.
+        static LatencyHistogram& latency = Metrics::global().histogram("search");
+        ScopedLatency timer(latency);
 
         // Switching to a heap of 10 elems reduces 60+ ms to ~10 ms with O0.
         TopElemsHeap<ComparableEntry> heap(max_results);
@@ -286,46 +368,70 @@ public:
             [](unsigned char c) { return std::tolower(c); });
 
         // Calculate tfidf of terms in query string.
-        double d_N = (double)docs.size();
-        std::unordered_map<std::string, double> q_tfidf;
+        TermVector q_tfidf;
         for (const auto& [ngram, freq] : make_tf(l_query)) {
-            if (occ.find(ngram) != occ.end()) {
-                q_tfidf[ngram] = freq * (1 + std::log(d_N / (double)occ.at(ngram)));
+            auto found = occ.find(ngram);
+            if (found != occ.end()) {
+                q_tfidf.push_back({ ngram, freq * term_idf(found->second) });
+            }
+        }
+
+        // Accumulate the dot product with the query over the postings of
+        // the query terms only, applying the idf of each term as we go;
+        // entries sharing no term with the query have a similarity of 0, so
+        // they are only visited for a negative threshold.
+        for (const auto& [ngram, q_weight] : q_tfidf) {
+            auto found = postings.find(ngram);
+            double weight = q_weight * term_idf(occ.at(ngram));
+            for (const auto& [doc, freq] : found->second) {
+                if (dots[doc] == 0) {
+                    touched.push_back(doc);
+                }
+                dots[doc] += weight * freq;
             }
         }
 
+        if (threshold < 0) {
+            touched.clear();
+            for (size_t doc = 0; doc < docs.size(); ++doc) {
+                if (docs[doc].live) {
+                    touched.push_back(doc);
+                }
+            }
+        } else {
+            std::sort(touched.begin(), touched.end());
+        }
+
         // Add indexed entries whose cosine similarity is above the threshold.
-        double sim;
-        for (const auto& entry : docs) {
-            sim = cosine_similarity(q_tfidf, entry.tfidf);
+        double q_mag = magnitude(q_tfidf);
+        for (size_t doc : touched) {
+            IndexedEntry& entry = docs[doc];
+            double mag = q_mag + norm_of(entry);
+            double sim = mag == 0 ? 0.0 : dots[doc] / mag;
             if (sim > threshold) {
-                ComparableEntry newEntry = { entry.name, entry.data, sim };
-                heap.push(newEntry);
+                heap.emplace(entry.name, entry.data, sim);
             }
         }
 
+        // Reset the scratch space for the next search.
+        for (size_t doc : touched) {
+            dots[doc] = 0;
+        }
+        touched.clear();
+
         // Return as a sorted vector.
-        auto ret = heap.getElements();
-        std::sort(ret.rbegin(), ret.rend());
-        return ret;
+        return heap.drainSorted();
     }
 
     /**
-     *  @brief Updates internal indexing mechanism.
+     *  @brief Brings the norms of all entries up to date, so that later
+     *         searches need not; searches are correct without it.
      */
     void index()
     {
-        double d_N = (double)docs.size();
-
-        // Calculate idf for each term present in corpus.
-        for (const auto& [ngram, freq] : occ) {
-            idf[ngram] = 1 + std::log(d_N / (double)freq);
-        }
-
-        // Calculate tfidf for each term in every document in corpus.
-        for (auto& index : docs) {
-            for (const auto& [ngram, freq] : index.tf) {
-                index.tfidf[ngram] = freq * idf[ngram];
+        for (auto& entry : docs) {
+            if (entry.live) {
+                norm_of(entry);
             }
         }
     }
@@ -3,6 +3,7 @@
 #define SHARED_VECTOR_H
 
 #include <vector>
+#include <array>
 #include <string.h>
 #include <iostream>
 
@@ -10,8 +11,10 @@
 // A specialized vector class that only allows items to be appended not removed,
 // and which implements a copy on write mechanism to reduce data use; it also
 // allows for one value at a time to be queued before being actually added
-// to the vector
-template <class T>
+// to the vector. The first N elements are stored inline, so short vectors need
+// no allocation and are copied with a single memcpy; only vectors longer than
+// N spill to the shared, reference counted storage
+template <class T, size_t N = 0>
 class SharedVector {
     private:
         
@@ -30,6 +33,17 @@ class SharedVector {
                 size(0),
                 refCount(1) {}
 
+            // Constructor which copies n elements from an array into a Vector
+            // with room for capacity elements
+            Vector(const T * elems, size_t nElems, size_t capacity) :
+                data(new T[capacity]),
+                cap(capacity),
+                size(nElems),
+                refCount(1) {
+
+                memcpy(this -> data, elems, sizeof(T) * nElems);
+            }
+
             // Copy constructor
             Vector(Vector& vec) :
                 refCount(1),
@@ -91,38 +105,57 @@ class SharedVector {
         // than are stored in the underlying vector
         size_t size;
 
-        // reference to the underlying vector
+        // reference to the underlying vector; null while the elements fit
+        // inline
         Vector * vec;
 
+        // the elements while there are at most N of them
+        std::array<T, N> inlineData;
+
         // the queued element and whether an element is currently queued
         T queued;
         bool queueFull;
 
+        // release
+        // drop the reference to the underlying vector, if any, freeing it if
+        // it was the last one
+        void release() {
+            if (this -> vec != nullptr) {
+                this -> vec -> refCount -= 1;
+                if (this -> vec -> refCount == 0) {
+                    delete this -> vec;
+                }
+            }
+        }
+
     public:
 
         // Constructor for empty SharedVector
-        SharedVector() : size(0), vec(new Vector()), queued(),
-            queueFull(false) {}
+        SharedVector() : size(0), vec(N > 0 ? nullptr : new Vector()),
+            inlineData(), queued(), queueFull(false) {}
 
-        // Copy constructor: increases underlying vector's reference count
-        // instead of copying
+        // Copy constructor: copies inline elements, and increases underlying
+        // vector's reference count instead of copying it
         SharedVector(const SharedVector& rhs) : size(rhs.size), vec(rhs.vec),
-            queued(rhs.queued), queueFull(rhs.queueFull) {
+            inlineData(rhs.inlineData), queued(rhs.queued),
+            queueFull(rhs.queueFull) {
             
-            this -> vec -> refCount += 1;
+            if (this -> vec != nullptr) {
+                this -> vec -> refCount += 1;
+            }
         }
 
-        // Copy assignment: increases underlying vector's reference count
-        // instead of copying
+        // Copy assignment: copies inline elements, and increases underlying
+        // vector's reference count instead of copying it
         SharedVector& operator=(const SharedVector& rhs) {
             if (&rhs != this) {
-                this -> vec -> refCount -= 1;
-                if (this -> vec -> refCount == 0) {
-                    delete vec;
+                if (rhs.vec != nullptr) {
+                    rhs.vec -> refCount += 1;
                 }
+                this -> release();
 
                 this -> vec = rhs.vec;
-                this -> vec -> refCount += 1;
+                this -> inlineData = rhs.inlineData;
                 this -> size = rhs.size;
                 this -> queued = rhs.queued;
                 this -> queueFull = rhs.queueFull;
@@ -132,10 +165,7 @@ class SharedVector {
 
         // destructor: only frees underlying vector if reference count is zero
         ~SharedVector() {
-            this -> vec -> refCount -= 1;
-            if (this -> vec -> refCount == 0) {
-                delete vec;
-            }
+            this -> release();
         }
 
         // queue
@@ -149,6 +179,21 @@ class SharedVector {
         // add a queued element (if any) to the underlying vector
         void flushQueue() {
 
+            // keep the element inline if there is room, or spill every
+            // element to a vector of our own if there is not
+            if constexpr (N > 0) {
+                if (this -> queueFull && this -> vec == nullptr) {
+                    if (this -> size < N) {
+                        this -> inlineData[this -> size] = this -> queued;
+                        this -> size += 1;
+                        this -> queueFull = false;
+                        return;
+                    }
+                    this -> vec = new Vector(this -> inlineData.data(),
+                        this -> size, 2 * N);
+                }
+            }
+
             // check if there is a queued element
             if (this -> queueFull) {
 
@@ -175,7 +220,8 @@ class SharedVector {
         // getArray
         // get an immutable pointer to the data
         const T * getArray() const {
-            return this -> vec -> data;
+            return this -> vec != nullptr ? this -> vec -> data
+                : this -> inlineData.data();
         }
 
         // getSize
@@ -188,14 +234,20 @@ class SharedVector {
         // display the vector contents to stdout
         void display() const {
 
-            // display the reference count and reference
-            std::cout << "(" << this -> vec -> refCount << " @"
-                << (void*)this -> vec -> data << ")";
+            // display the reference count and reference, or that the
+            // elements are inline
+            if (this -> vec != nullptr) {
+                std::cout << "(" << this -> vec -> refCount << " @"
+                    << (void*)this -> vec -> data << ")";
+            }
+            else {
+                std::cout << "(inline)";
+            }
             
             // display the elements in the vector
             std::cout << " [";
             for (size_t i = 0; i < this -> size; ++i) {
-                std::cout << this -> vec -> data[i] << ", ";
+                std::cout << this -> getArray()[i] << ", ";
             }
             std::cout << "]" << std::endl;
         }
@@ -0,0 +1,95 @@
+
+#ifndef SOFT_OBJECTIVE_H
+#define SOFT_OBJECTIVE_H
+
+#include <array>
+
+// WeekOccupancy
+// the summary of a schedule's week that soft objectives are computed from: for
+// every day, the start of its first class, the end of its last class and the
+// time spent in classes. Intervals belong to the day they start on, and times
+// are measured from the start of the week in units where a day is dayLength
+// long (minutes by default, as in the catalogue)
+class WeekOccupancy {
+	public:
+		static const unsigned int DAYS = 7;
+
+	private:
+		double dayLength;
+		std::array<double, DAYS> first;
+		std::array<double, DAYS> last;
+		std::array<double, DAYS> busy;
+
+		// the time between classes that is not spent in classes, summed over
+		// every day
+		double totalGaps;
+
+	public:
+		// constructor
+		WeekOccupancy(double lengthOfDay = 1440);
+
+		unsigned int dayOf(double time) const;
+		double timeOfDay(double time) const;
+		bool isUsed(unsigned int day) const;
+		double getTotalGaps() const;
+		double gapsAfter(double begin, double end) const;
+
+		void add(double begin, double end);
+};
+
+// SoftObjective
+// a preference about the shape of a schedule's week, expressed as a cost that
+// grows as classes are added. delta must be O(1): it only looks at the summary
+// in WeekOccupancy. Since adding a class may also lower the cost of some
+// objectives, recoverable gives an upper bound on how much cost more classes
+// could still remove, which keeps the bounds of the searches admissible
+class SoftObjective {
+	public:
+		virtual ~SoftObjective() = default;
+
+		// the cost that adding the interval [begin, end) to the week adds
+		virtual double delta(const WeekOccupancy& week, double begin,
+			double end) const = 0;
+
+		// the most cost that adding more intervals to the week could remove
+		virtual double recoverable(const WeekOccupancy& week) const;
+};
+
+// GapObjective
+// costs the idle time between classes on the same day, in time units
+class GapObjective : public SoftObjective {
+	public:
+		double delta(const WeekOccupancy& week, double begin,
+			double end) const override;
+		double recoverable(const WeekOccupancy& week) const override;
+};
+
+// EarlyStartObjective
+// costs 1 for every class that starts before the given time of day, e.g. 480
+// for no classes before 8 a.m.
+class EarlyStartObjective : public SoftObjective {
+	private:
+		double earliest;
+
+	public:
+		EarlyStartObjective(double earliestStart);
+
+		double delta(const WeekOccupancy& week, double begin,
+			double end) const override;
+};
+
+// FreeDayObjective
+// costs 1 if the given day of the week, counted from 0, has any class; e.g. 4
+// keeps Fridays free when the week starts on Monday
+class FreeDayObjective : public SoftObjective {
+	private:
+		unsigned int freeDay;
+
+	public:
+		FreeDayObjective(unsigned int day);
+
+		double delta(const WeekOccupancy& week, double begin,
+			double end) const override;
+};
+
+#endif // SOFT_OBJECTIVE_H
@@ -4,47 +4,139 @@
 
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
 
 // TopElemsHeap -- a data structure that keeps only the top maxElems elements
-// that are added to it
-template<class T>
+// that are added to it. Elements are ranked by the key that Key projects them
+// to, which by default is the element itself; projecting heavy elements to a
+// cheap key such as a score keeps comparisons cheap
+template<class T, class Key = std::identity>
 class TopElemsHeap {
     private:
         // the maximum size of the heap
         const size_t maxElems;
-        
+
         // the elemtns themselves, which are heapified after every operation
         std::vector<T> elems;
 
+        // the projection from an element to the key it is ranked by
+        Key key;
+
+        // greater
+        // whether a ranks above b; the heap is ordered by this so that its
+        // front is the lowest ranked element
+        bool greater(const T& a, const T& b) const {
+            return std::invoke(this -> key, a) > std::invoke(this -> key, b);
+        }
+
+        // comparator
+        // greater as a function object for the standard heap algorithms
+        auto comparator() const {
+            return [this](const T& a, const T& b) { return this -> greater(a, b); };
+        }
+
     public:
-        
+
         // constructor
-        TopElemsHeap(size_t n) : maxElems(n), elems() {}
+        TopElemsHeap(size_t n, Key projection = Key()) : maxElems(n), elems(),
+            key(projection) {}
 
         // push
         // add a value to the heap; if the heap is already at capacity, the
         // lowest element will be removed by this operaiton
-        void push(T& value) {
+        void push(const T& value) {
+            T copy = value;
+            this -> push(std::move(copy));
+        }
+
+        // push
+        // add a value to the heap, moving it instead of copying it
+        void push(T&& value) {
 
-            // do not even add the element if the heap is at capacity and the 
+            // do not even add the element if the heap is at capacity and the
             // new value would be the smallest entry anyway
             if (this -> elems.size() >= this -> maxElems
-                && value <= this -> elems.front()) {
-                
+                && (this -> maxElems == 0
+                || !this -> greater(value, this -> elems.front()))) {
+
                 return;
             }
-            
-            this -> elems.push_back(value);
-            std::push_heap(this -> elems.begin(), this -> elems.end(), std::greater());
+
+            this -> elems.push_back(std::move(value));
+            std::push_heap(this -> elems.begin(), this -> elems.end(),
+                this -> comparator());
 
             // if adding the element breaks the heap capacity, remove the
             // smallest element
             if (this -> elems.size() > this -> maxElems) {
-                std::pop_heap(this -> elems.begin(), this -> elems.end(), std::greater());
+                std::pop_heap(this -> elems.begin(), this -> elems.end(),
+                    this -> comparator());
                 this -> elems.pop_back();
             }
         }
 
+        // emplace
+        // construct a value from args and add it to the heap
+        template<class... Args>
+        void emplace(Args&&... args) {
+            this -> push(T(std::forward<Args>(args)...));
+        }
+
+        // pushRange
+        // add every value in [first, last) to the heap at once; the values are
+        // appended, the top maxElems are selected with a partial sort, and
+        // the heap is rebuilt, which is linear in the number of values rather
+        // than taking a heap operation for each. Pass move iterators to move
+        // the values instead of copying them
+        template<class InputIt>
+        void pushRange(InputIt first, InputIt last) {
+            this -> elems.insert(this -> elems.end(), first, last);
+
+            if (this -> elems.size() > this -> maxElems) {
+                auto firstDropped = this -> elems.begin() + (long)this -> maxElems;
+                std::nth_element(this -> elems.begin(), firstDropped,
+                    this -> elems.end(), this -> comparator());
+                this -> elems.erase(firstDropped, this -> elems.end());
+            }
+            std::make_heap(this -> elems.begin(), this -> elems.end(),
+                this -> comparator());
+        }
+
+        // removeIf
+        // remove every element for which pred returns true
+        template<class Predicate>
+        void removeIf(Predicate pred) {
+            this -> elems.erase(std::remove_if(this -> elems.begin(),
+                this -> elems.end(), pred), this -> elems.end());
+            std::make_heap(this -> elems.begin(), this -> elems.end(),
+                this -> comparator());
+        }
+
+        // clear
+        // remove every element from the heap
+        void clear() {
+            this -> elems.clear();
+        }
+
+        // drainSorted
+        // remove every element from the heap, returning them highest ranked
+        // first
+        std::vector<T> drainSorted() {
+            std::sort_heap(this -> elems.begin(), this -> elems.end(),
+                this -> comparator());
+            std::vector<T> sorted = std::move(this -> elems);
+            this -> elems.clear();
+            return sorted;
+        }
+
+        // getMaxElems
+        // the number of elements the heap keeps
+        size_t getMaxElems() const {
+            return this -> maxElems;
+        }
+
         // getElements
         // return an immutable reference to the internal vector
         const std::vector<T>& getElements() const {
@@ -58,4 +150,4 @@ class TopElemsHeap {
         }
 };
 
-#endif
\ No newline at end of file
+#endif
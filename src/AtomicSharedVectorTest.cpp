@@ -0,0 +1,102 @@
+// AtomicSharedVectorTest.cpp
+// Stress test the AtomicSharedVector class from several threads at once; the
+// AtomicSharedVectorTsanTest target runs it under ThreadSanitizer as well
+
+#include "AtomicSharedVector.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <random>
+
+// a vector together with the elements it is expected to hold
+struct Tracked {
+    AtomicSharedVector<int> vec;
+    std::vector<int> expected;
+};
+
+// matches
+// whether a vector holds exactly the expected elements
+bool matches(const Tracked& tracked) {
+    if (tracked.vec.getSize() != tracked.expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < tracked.expected.size(); ++i) {
+        if (tracked.vec.getArray()[i] != tracked.expected[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+
+    const int nThreads = 8;
+    const int nRounds = 20000;
+
+    // a shelf of vectors that the threads take copies of and put copies back
+    // on, so that copies sharing a buffer are appended to from every thread
+    Tracked base = {AtomicSharedVector<int>(), std::vector<int>()};
+    for (int i = 0; i < 5; ++i) {
+        base.vec.queue(i);
+        base.vec.flushQueue();
+        base.expected.push_back(i);
+    }
+    std::vector<Tracked> shelf(16, base);
+    std::mutex shelfLock;
+    std::vector<int> mismatches(nThreads, 0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng((unsigned int)t);
+            for (int round = 0; round < nRounds; ++round) {
+
+                // take a copy of a vector on the shelf
+                std::unique_lock<std::mutex> taking(shelfLock);
+                Tracked local = shelf[rng() % shelf.size()];
+                taking.unlock();
+
+                // append to it while other threads append to copies of the
+                // same buffer
+                int nAppends = 1 + (int)(rng() % 3);
+                for (int i = 0; i < nAppends; ++i) {
+                    int value = t * nRounds * 4 + round * 4 + i;
+                    local.vec.queue(value);
+                    local.vec.flushQueue();
+                    local.expected.push_back(value);
+                    if (!matches(local)) {
+                        ++mismatches[(size_t)t];
+                    }
+                }
+
+                // sometimes put it back, keeping the shelf's vectors short
+                if (rng() % 4 == 0) {
+                    std::lock_guard<std::mutex> guard(shelfLock);
+                    shelf[rng() % shelf.size()] =
+                        local.expected.size() < 200 ? local : base;
+                }
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    int total = 0;
+    for (int count: mismatches) {
+        total += count;
+    }
+    for (auto& tracked: shelf) {
+        if (!matches(tracked)) {
+            ++total;
+        }
+    }
+    std::cout << "mismatches after " << nThreads * nRounds
+        << " rounds (expected 0): " << total << std::endl;
+
+    // the base vector was shared with every thread, but never changed
+    std::cout << "base (expected [0, 1, 2, 3, 4, ]): ";
+    base.vec.display();
+
+    return total != 0;
+}
@@ -0,0 +1,40 @@
+// BitsetTest.cpp
+// Test the Bitset class - checks the word at a time operations across word
+// boundaries
+
+#include "Bitset.h"
+
+int main() {
+
+    // create two sets that span a few words
+    Bitset A(150, true);
+    Bitset B(150, false);
+    for (size_t i = 60; i < 70; ++i) {
+        B.set(i);
+    }
+    B.set(140);
+
+    std::cout << "A count (expected 150): " << A.count() << std::endl;
+    std::cout << "B count (expected 11): " << B.count() << std::endl;
+
+    // remove B from A, and check the ranges around the removed bits
+    A.andNot(B);
+    std::cout << "A count after andNot (expected 139): " << A.count()
+        << std::endl;
+    std::cout << "any in [60, 70) (expected 0): " << A.anyInRange(60, 70)
+        << std::endl;
+    std::cout << "any in [59, 70) (expected 1): " << A.anyInRange(59, 70)
+        << std::endl;
+    std::cout << "count in [0, 128) (expected 118): " << A.countInRange(0, 128)
+        << std::endl;
+
+    // reuse a scratch set for the result of an and not
+    Bitset C;
+    C.assignAndNot(B, Bitset(150, false));
+    C &= B;
+    C.reset(140);
+    std::cout << "C: ";
+    C.display(std::cout);
+
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include <Catalogue.h>
 #include <Interval.h>
 #include <Event.h>
+#include <Metrics.h>
 #include <fstream>
 #include <iostream>
 #include <json.h>
@@ -103,6 +104,8 @@ Catalogue::Catalogue(std::string json_filename) : entries(), engine() {
  *         EXIT_FAILURE on failure, EXIT_SUCCESS on success
  */
 int Catalogue::load(std::string json_filename) {
+    static LatencyHistogram& latency = Metrics::global().histogram("catalogue.load");
+    ScopedLatency timer(latency);
 
     // read file into json if possible
     std::ifstream file(json_filename);
@@ -0,0 +1,89 @@
+// ConcurrentTopElemsHeapTest.cpp
+// Push to a ConcurrentTopElemsHeap from several threads at once, merging it
+// while they push, and check the result against a sequential top k; the
+// ConcurrentTopElemsHeapTsanTest target runs it under ThreadSanitizer as well
+
+#include "ConcurrentTopElemsHeap.h"
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <string>
+
+int main() {
+
+    const size_t nThreads = 8;
+    const size_t nValues = 100000;
+    const size_t k = 50;
+
+    // the values each thread pushes
+    std::vector<std::vector<int>> values(nThreads);
+    for (size_t t = 0; t < nThreads; ++t) {
+        std::mt19937 rng((unsigned int)t);
+        for (size_t i = 0; i < nValues; ++i) {
+            values[t].push_back((int)(rng() % 1000000));
+        }
+    }
+
+    // push from every thread, merging a few times while they do
+    ConcurrentTopElemsHeap<int> top(k, nThreads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < nThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            auto& shard = top.getShard(t);
+            for (int value: values[t]) {
+                shard.push(value);
+            }
+        });
+    }
+    int badMerges = 0;
+    for (int i = 0; i < 5; ++i) {
+        std::vector<int> partial = top.getSorted();
+        if (partial.size() > k || !std::is_sorted(partial.rbegin(),
+            partial.rend())) {
+
+            ++badMerges;
+        }
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    // the top k of every value pushed, found sequentially
+    std::vector<int> expected;
+    for (auto& threadValues: values) {
+        expected.insert(expected.end(), threadValues.begin(),
+            threadValues.end());
+    }
+    std::sort(expected.rbegin(), expected.rend());
+    expected.resize(k);
+
+    std::vector<int> merged = top.getSorted();
+    std::vector<int> drained = top.drainSorted();
+    std::cout << "top " << k << " of " << nThreads * nValues
+        << " matches (expected 1): " << (merged == expected
+        && drained == expected && badMerges == 0) << std::endl;
+    std::cout << "empty after drain (expected 1): "
+        << top.getSorted().empty() << std::endl;
+
+    // rank heavier elements by a cheap key, here pairs by their score
+    typedef std::pair<std::string, int> Named;
+    ConcurrentTopElemsHeap<Named, int Named::*> named(3, 2, &Named::second);
+    std::thread producer([&]() {
+        for (int i = 0; i < 10; ++i) {
+            named.getShard(0).push({"even" + std::to_string(i), 2 * i});
+        }
+    });
+    for (int i = 0; i < 10; ++i) {
+        named.getShard(1).push({"odd" + std::to_string(i), 2 * i + 1});
+    }
+    producer.join();
+    std::cout << "top 3 (expected odd9=19, even9=18, odd8=17): ";
+    for (auto& entry: named.drainSorted()) {
+        std::cout << entry.first << "=" << entry.second << ", ";
+    }
+    std::cout << std::endl;
+
+    return !(merged == expected && drained == expected && badMerges == 0);
+}
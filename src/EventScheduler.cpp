@@ -1,5 +1,17 @@
 
 #include "EventScheduler.h" 
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <cmath>
+#include <set>
+#include <tuple>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 // EventScheduler constructor
 EventScheduler::EventScheduler(unsigned int maxEvents,
@@ -7,34 +19,148 @@ EventScheduler::EventScheduler(unsigned int maxEvents,
 	eventsToSchedule(maxEvents),
 	events(),
 	sections(),
-	eventSectionsStartIndex(),
+	eventSectionRanges(),
+	choiceGroupMembers(),
+	choiceGroupOf(),
+	bundleComponents(),
+	bundleLinks(),
+	exclusionTimes(),
+	exclusions(),
+	objectives(),
+	dayLength(1440),
 	conflicts(),
-	maxSecPerEvent(maxSectionsPerEvent) {}
+	spareConflicts(),
+	maxSecPerEvent(maxSectionsPerEvent),
+	improveIterations(0),
+	improveNeighbourhood(3),
+	improveTimeLimit(0),
+	improveSeed(0),
+	adaptiveBudget(0),
+	adaptiveMinWidth(8),
+	autoExactLimit(5),
+	autoBeamWork(100000),
+	solverChoice({SolverChoice::EXACT, 0, 0, 0}),
+	feasible(true),
+	optimal(true),
+	optimalityGap(0),
+	warmStart(true),
+	warmSchedules() {}
 
 // getSectionID
-// produce the sectionID for an section given its eventID and section index
+// produce the sectionID for an section given its eventID and section index;
+// NO_SECTION if the section was left out, because of an exclusion or the
+// limit on sections per event. The event may be a member of a choice group
 EventScheduler::SectionID EventScheduler::getSectionID(unsigned int eventID,
 	unsigned int sectionIndex) const {
 	
-	return this -> eventSectionsStartIndex.at(eventID) + sectionIndex;
+	auto range = this -> eventSectionRanges.at(this -> searchEventID(eventID));
+	for (SectionID secID = range.first; secID < range.second; ++secID) {
+		if (this -> sections[secID].eventID == eventID
+			&& this -> sections[secID].sectionIndex == sectionIndex) {
+
+			return secID;
+		}
+	}
+	return NO_SECTION;
 }
 
-// comparison operators for an EventWrapper so that it can be used in a priority
-// queue
+// searchEventID
+// the id of the event that the searches see for an event id: the id of its
+// choice group for members of a group, and the id itself otherwise
+unsigned int EventScheduler::searchEventID(unsigned int eventID) const {
+	auto group = this -> choiceGroupOf.find(eventID);
+	return group == this -> choiceGroupOf.end() ? eventID : group -> second;
+}
+
+// addSections
+// add the sections of an event that was stored in the events table to the end
+// of the sections list; the number of sections is limited to meet performance
+// constraints, and sections that overlap an exclusion are left out
+void EventScheduler::addSections(unsigned int eventID, double weight) {
+
+	const Event& event = this -> events.at(eventID);
+	unsigned int nSections = event.size() < this -> maxSecPerEvent
+		? (unsigned int)event.size() 
+		: this -> maxSecPerEvent;
+	for (unsigned int i = 0; i < nSections; ++i) {
+		const IntervalGroup * section = event.getSectionPtr(i);
+		if (!this -> isExcluded(*section)) {
+			this -> sections.push_back({eventID, i, section, weight});
+		}
+	}
+}
+
+// isExcluded
+// return whether a section overlaps any of the exclusions
+bool EventScheduler::isExcluded(const IntervalGroup& section) const {
+	return section.intersects(this -> exclusions);
+}
+
+// eraseSections
+// remove the sections whose id is set in drop; the sections after them move
+// down to fill their place, and their rows and columns are removed from the
+// conflicts graph so that it does not need to be built again
+void EventScheduler::eraseSections(const Bitset& drop) {
+
+	// the new id of every section, and of the end of the list
+	std::vector<SectionID> newID(this -> sections.size() + 1);
+	SectionID next = 0;
+	for (SectionID secID = 0; secID < this -> sections.size(); ++secID) {
+		newID[secID] = next;
+		if (!drop.test(secID)) {
+			this -> sections[next++] = this -> sections[secID];
+		}
+	}
+	newID[this -> sections.size()] = next;
+	this -> sections.resize(next);
+
+	for (auto& eventRange: this -> eventSectionRanges) {
+		eventRange.second = {newID[eventRange.second.first],
+			newID[eventRange.second.second]};
+	}
+
+	// remove the rows and columns of the sections that were already built
+	size_t nBuilt = this -> conflicts.size();
+	size_t nKept = 0;
+	for (SectionID secID = 0; secID < nBuilt; ++secID) {
+		if (!drop.test(secID)) {
+			if (nKept != secID) {
+				this -> conflicts[nKept] = std::move(this -> conflicts[secID]);
+			}
+			++nKept;
+		}
+	}
+	this -> conflicts.resize(nKept);
+	for (auto& sectionConflicts: this -> conflicts) {
+		sectionConflicts.erase(drop);
+	}
+}
+
+// comparison operators for a ScheduleWrapper so that the beam keeps the
+// schedules with the largest score, and among schedules with the same score
+// the ones with the largest optimistic score: the score plus the bound on what
+// the remaining events can add. A schedule that has blocked the remaining
+// events ranks below one that kept them open
 bool EventScheduler::ScheduleWrapper::operator<(const ScheduleWrapper& rhs) const {
-	return this -> weight < rhs.weight;
+	return this -> rank() < rhs.rank();
 }
 bool EventScheduler::ScheduleWrapper::operator>(const ScheduleWrapper& rhs) const {
-	return this -> weight > rhs.weight;
+	return this -> rank() > rhs.rank();
 }
 bool EventScheduler::ScheduleWrapper::operator<=(const ScheduleWrapper& rhs) const {
-	return this -> weight <= rhs.weight;
+	return this -> rank() <= rhs.rank();
 }
 bool EventScheduler::ScheduleWrapper::operator>=(const ScheduleWrapper& rhs) const {
-	return this -> weight >= rhs.weight;
+	return this -> rank() >= rhs.rank();
 }
 bool EventScheduler::ScheduleWrapper::operator==(const ScheduleWrapper& rhs) const {
-	return this -> weight == rhs.weight;
+	return this -> rank() == rhs.rank();
+}
+
+// rank
+// the key that schedules are compared by
+std::pair<double, double> EventScheduler::ScheduleWrapper::rank() const {
+	return std::make_pair(this -> score, this -> score + this -> bound);
 }
 
 // sectionConflictsWithSchedule
@@ -42,14 +168,14 @@ bool EventScheduler::ScheduleWrapper::operator==(const ScheduleWrapper& rhs) con
 bool EventScheduler::sectionConflictsWithSchedule(Schedule& sched,
 	SectionID sec) const {
 
-	const std::vector<bool>& sectionConflicts = this -> conflicts.at(sec);
+	const Bitset& sectionConflicts = this -> conflicts.at(sec);
 
 	const SectionID * secIDs = sched.getArray();
 	const size_t nSecIDs = sched.getSize();
 
 	// check every section in the schedule against this section
 	for (size_t i = 0; i < nSecIDs; ++i) {
-		if (sectionConflicts[secIDs[i]]) {
+		if (sectionConflicts.test(secIDs[i])) {
 			return true;
 		}
 	}
@@ -59,77 +185,825 @@ bool EventScheduler::sectionConflictsWithSchedule(Schedule& sched,
 
 
 // comparison operators for an EventWrapper so that it can be used in a priority
-// queue
+// queue; required events rank above every optional event, so they are never
+// the ones dropped when there are too many events
 bool EventScheduler::EventWrapper::operator<(const EventWrapper& rhs) const {
-	return this -> weight < rhs.weight;
+	return std::make_pair(this -> required, this -> weight)
+		< std::make_pair(rhs.required, rhs.weight);
 }
 bool EventScheduler::EventWrapper::operator>(const EventWrapper& rhs) const {
-	return this -> weight > rhs.weight;
+	return rhs < *this;
 }
 bool EventScheduler::EventWrapper::operator<=(const EventWrapper& rhs) const {
-	return this -> weight <= rhs.weight;
+	return !(rhs < *this);
 }
 bool EventScheduler::EventWrapper::operator>=(const EventWrapper& rhs) const {
-	return this -> weight >= rhs.weight;
+	return !(*this < rhs);
 }
 bool EventScheduler::EventWrapper::operator==(const EventWrapper& rhs) const {
-	return this -> weight == rhs.weight;
+	return this -> required == rhs.required && this -> weight == rhs.weight;
 }
 
 // addEvent
 // add an event to the scheduler; in addition to the event itself, an integer
 // id that is unique to this event scheduler must be specified; A weight
 // describing the preference for this event can be included as well; if not
-// specified it will default to 1.0
-void EventScheduler::addEvent(const Event& event, unsigned int id, double weight) {
+// specified it will default to 1.0. A required event must be in every schedule
+// that is returned; if no schedule can fit all of the required events, the
+// builds return no schedule and isFeasible returns false
+void EventScheduler::addEvent(const Event& event, unsigned int id, double weight,
+	bool required) {
 
 	// add the event to the priority queue and id lookup table, and find its
 	// conflicts with other events
-	EventWrapper eventToSchedule = {id, event, weight};
+	EventWrapper eventToSchedule = {id, event, weight, required};
 	this -> eventsToSchedule.push(eventToSchedule);
 	this -> events.insert({id, event});
-	this -> eventSectionsStartIndex.insert({id, this -> sections.size()});
+	SectionID begin = this -> sections.size();
+	this -> addSections(id, weight);
+	this -> eventSectionRanges.insert({id, {begin, this -> sections.size()}});
+}
 
-	// limit number of sections to meet perfomrance constraints
-	unsigned int nSections = event.size() < this -> maxSecPerEvent
-		? (unsigned int)event.size() 
-		: this -> maxSecPerEvent;
-	for (unsigned int i = 0; i < nSections; ++i) {
-		this -> sections.push_back({id, i, this -> events[id].getSectionPtr(i)});
+// addChoiceGroup
+// add a group of events of which at most one may be scheduled, such as any one
+// of several electives; it is searched as a single event whose sections are
+// those of all its members, and choosing a section adds the weight of its
+// member. The group has its own id, which must not be used by any other event
+// or member; schedules report the id of the member that was chosen. A required
+// group must have one of its members in every schedule
+void EventScheduler::addChoiceGroup(const std::vector<ChoiceMember>& members,
+	unsigned int id, bool required) {
+
+	double maxWeight = -std::numeric_limits<double>::infinity();
+	SectionID begin = this -> sections.size();
+	for (auto& member: members) {
+		this -> events.insert({member.id, member.event});
+		this -> choiceGroupOf.insert({member.id, id});
+		this -> choiceGroupMembers[id].push_back(member.id);
+		this -> addSections(member.id, member.weight);
+		maxWeight = std::max(maxWeight, member.weight);
+	}
+	this -> eventSectionRanges.insert({id, {begin, this -> sections.size()}});
+
+	// the group is ranked by the weight of its best member
+	EventWrapper groupToSchedule = {id, Event(), maxWeight, required};
+	this -> eventsToSchedule.push(groupToSchedule);
+}
+
+// addBundle
+// add an event made of linked components that are all scheduled or none of
+// them, such as a lecture and its lab; each component is searched as an event
+// of its own, right after the one before it, so the sections of the bundle are
+// never multiplied out. Links restrict which sections of two components may be
+// taken together, and are added to the conflicts graph. The weight is added
+// once for the whole bundle; schedules report the ids of the components. The
+// bundle has its own id, which must not be used by any other event
+void EventScheduler::addBundle(const std::vector<BundleComponent>& components,
+	const std::vector<BundleLink>& links, unsigned int id, double weight,
+	bool required) {
+
+	// only the first component carries the weight of the bundle
+	for (size_t i = 0; i < components.size(); ++i) {
+		unsigned int componentID = components[i].id;
+		this -> events.insert({componentID, components[i].event});
+		this -> bundleComponents[id].push_back(componentID);
+
+		SectionID begin = this -> sections.size();
+		this -> addSections(componentID, i == 0 ? weight : 0);
+		this -> eventSectionRanges.insert({componentID,
+			{begin, this -> sections.size()}});
+	}
+	this -> bundleLinks[id] = links;
+
+	EventWrapper bundleToSchedule = {id, Event(), weight, required};
+	this -> eventsToSchedule.push(bundleToSchedule);
+}
+
+// removeEvent
+// remove an event, choice group or bundle from the scheduler; the sections of
+// the events added after it move down to fill its place, and its rows and
+// columns are removed from the conflicts graph so that it does not need to be
+// built again. Members of a choice group and components of a bundle can only
+// be removed with the whole group or bundle
+void EventScheduler::removeEvent(unsigned int id) {
+
+	// a bundle owns the sections of its components
+	std::vector<unsigned int> owners = {id};
+	auto bundle = this -> bundleComponents.find(id);
+	if (bundle != this -> bundleComponents.end()) {
+		owners = bundle -> second;
+		for (unsigned int componentID: bundle -> second) {
+			this -> events.erase(componentID);
+		}
+		this -> bundleComponents.erase(bundle);
+		this -> bundleLinks.erase(id);
+	}
+
+	Bitset drop(this -> sections.size(), false);
+	bool found = false;
+	for (unsigned int ownerID: owners) {
+		auto range = this -> eventSectionRanges.find(ownerID);
+		if (range == this -> eventSectionRanges.end()) {
+			continue;
+		}
+
+		for (SectionID secID = range -> second.first;
+			secID < range -> second.second; ++secID) {
+
+			drop.set(secID);
+		}
+		this -> eventSectionRanges.erase(range);
+		found = true;
+	}
+	if (!found) {
+		return;
+	}
+	this -> eraseSections(drop);
+
+	this -> eventsToSchedule.removeIf([id](const EventWrapper& ew) {
+		return ew.id == id;
+	});
+	this -> events.erase(id);
+
+	auto group = this -> choiceGroupMembers.find(id);
+	if (group != this -> choiceGroupMembers.end()) {
+		for (unsigned int memberID: group -> second) {
+			this -> events.erase(memberID);
+			this -> choiceGroupOf.erase(memberID);
+		}
+		this -> choiceGroupMembers.erase(group);
+	}
+}
+
+// reset
+// remove every event, exclusion and objective, and forget the last build, so
+// that the scheduler can be used for a new problem; the settings are kept, as
+// is the capacity of the sections list and the rows of the conflicts graph
+void EventScheduler::reset() {
+	this -> eventsToSchedule.clear();
+	this -> events.clear();
+	this -> sections.clear();
+	this -> eventSectionRanges.clear();
+	this -> choiceGroupMembers.clear();
+	this -> choiceGroupOf.clear();
+	this -> bundleComponents.clear();
+	this -> bundleLinks.clear();
+	this -> exclusionTimes.clear();
+	this -> exclusions = IntervalGroup();
+	this -> objectives.clear();
+
+	for (auto& row: this -> conflicts) {
+		this -> spareConflicts.push_back(std::move(row));
+	}
+	this -> conflicts.clear();
+
+	this -> solverChoice = {SolverChoice::EXACT, 0, 0, 0};
+	this -> feasible = true;
+	this -> optimal = true;
+	this -> optimalityGap = 0;
+	this -> warmSchedules.clear();
+}
+
+// idleSchedulers
+// the schedulers that the calling thread has returned and not checked out
+// again; at most MAX_IDLE are kept
+static std::vector<std::unique_ptr<EventScheduler>>& idleSchedulers() {
+	static thread_local std::vector<std::unique_ptr<EventScheduler>> idle;
+	return idle;
+}
+static const size_t MAX_IDLE = 8;
+
+// checkout
+// lease an idle scheduler of the calling thread that was made with the same
+// limits, or a new one if it has none
+EventScheduler::Lease EventScheduler::checkout(unsigned int maxEvents,
+	unsigned int maxSectionsPerEvent) {
+
+	auto& idle = idleSchedulers();
+	for (auto it = idle.rbegin(); it != idle.rend(); ++it) {
+		if ((*it) -> eventsToSchedule.getMaxElems() == maxEvents
+			&& (*it) -> maxSecPerEvent == maxSectionsPerEvent) {
+
+			EventScheduler * sched = it -> release();
+			idle.erase(std::next(it).base());
+			return Lease(sched);
+		}
+	}
+	return Lease(new EventScheduler(maxEvents, maxSectionsPerEvent));
+}
+
+// Lease constructor
+EventScheduler::Lease::Lease(EventScheduler * leased) : sched(leased) {}
+
+// Lease move constructor
+EventScheduler::Lease::Lease(Lease&& rhs) noexcept : sched(rhs.sched) {
+	rhs.sched = nullptr;
+}
+
+// Lease destructor
+// reset the scheduler and return it to the calling thread's idle schedulers,
+// or free it if there are enough of those already
+EventScheduler::Lease::~Lease() {
+	if (this -> sched == nullptr) {
+		return;
+	}
+
+	std::unique_ptr<EventScheduler> owned(this -> sched);
+	auto& idle = idleSchedulers();
+	if (idle.size() < MAX_IDLE) {
+		owned -> reset();
+		idle.push_back(std::move(owned));
+	}
+}
+
+// Lease operator*
+EventScheduler& EventScheduler::Lease::operator*() const {
+	return *this -> sched;
+}
+
+// Lease operator->
+EventScheduler * EventScheduler::Lease::operator->() const {
+	return this -> sched;
+}
+
+// addExclusion
+// block out times that no section may overlap; sections that overlap them are
+// removed once, here or when their event is added, so the searches never see
+// them. Events left without sections are not scheduled
+void EventScheduler::addExclusion(const IntervalGroup& times) {
+
+	// merge the new times into the sorted, non overlapping exclusion times
+	for (unsigned int i = 0; i < times.getIntervalSize(); ++i) {
+		this -> exclusionTimes.push_back(times.getInterval(i));
+	}
+	std::sort(this -> exclusionTimes.begin(), this -> exclusionTimes.end());
+	std::vector<std::pair<double, double>> merged;
+	for (auto& interval: this -> exclusionTimes) {
+		if (!merged.empty() && interval.first < merged.back().second) {
+			merged.back().second = std::max(merged.back().second, interval.second);
+		}
+		else {
+			merged.push_back(interval);
+		}
+	}
+	this -> exclusionTimes = merged;
+	this -> exclusions = IntervalGroup(merged);
+
+	// remove the sections that were already added and overlap the new times
+	Bitset drop(this -> sections.size(), false);
+	for (SectionID secID = 0; secID < this -> sections.size(); ++secID) {
+		if (this -> sections[secID].section -> intersects(times)) {
+			drop.set(secID);
+		}
+	}
+	if (drop.any()) {
+		this -> eraseSections(drop);
+	}
+}
+
+// addObjective
+// add a soft objective; a schedule's score is the weight of its sections less
+// the cost of each objective times its weight, which must not be negative
+void EventScheduler::addObjective(std::shared_ptr<const SoftObjective> objective,
+	double weight) {
+
+	if (weight < 0) {
+		throw std::invalid_argument("objective weights must not be negative");
+	}
+	this -> objectives.push_back({std::move(objective), weight});
+}
+
+// setDayLength
+// set the length of a day in the units of the sections' times, which the
+// objectives use to split a schedule into days; 1440 (minutes) by default
+void EventScheduler::setDayLength(double length) {
+	this -> dayLength = length;
+}
+
+// isFeasible
+// whether the last build found a schedule that fits every required event
+bool EventScheduler::isFeasible() const {
+	return this -> feasible;
+}
+
+// isOptimal
+// whether the last build is known to have returned the best schedules; always
+// true for the exact builds
+bool EventScheduler::isOptimal() const {
+	return this -> optimal;
+}
+
+// getOptimalityGap
+// how much the score of the worst schedule returned by the last build could
+// be below that of a schedule it missed; 0 if the build was optimal, and
+// infinity if fewer schedules were found than asked for and more might exist
+double EventScheduler::getOptimalityGap() const {
+	return this -> optimalityGap;
+}
+
+// setWarmStart
+// choose whether buildApproxSchedule starts from the schedules of its last
+// call; it does by default. Disabling it also forgets those schedules
+void EventScheduler::setWarmStart(bool enabled) {
+	this -> warmStart = enabled;
+	if (!enabled) {
+		this -> warmSchedules.clear();
 	}
 }
 
+// setImprovementPhase
+// enable the large neighbourhood search that buildApproxSchedule runs on its
+// result: for the given number of rounds, neighbourhoodSize events are freed
+// from the best schedule and re-solved exactly with all other sections fixed;
+// the phase also stops once timeLimitMs milliseconds have passed, if given.
+// Setting iterations to 0 disables the phase
+void EventScheduler::setImprovementPhase(unsigned int iterations,
+	unsigned int neighbourhoodSize, double timeLimitMs, unsigned int seed) {
+
+	this -> improveIterations = iterations;
+	this -> improveNeighbourhood = neighbourhoodSize;
+	this -> improveTimeLimit = timeLimitMs;
+	this -> improveSeed = seed;
+}
+
+// setAdaptiveBeam
+// let buildApproxSchedule choose the width of its beam every round instead of
+// always keeping maxConsidered schedules, which becomes the largest width.
+// workBudget is the number of candidate schedules the beam may evaluate in
+// total, and at least about minWidth schedules are kept alive each round as
+// long as the budget allows. A budget of 0 disables the adaptive width
+void EventScheduler::setAdaptiveBeam(size_t workBudget, unsigned int minWidth) {
+	this -> adaptiveBudget = workBudget;
+	this -> adaptiveMinWidth = std::max(minWidth, 1u);
+}
+
+// setAutoThresholds
+// tune the choices of autoSchedule: the exact search is picked when it is
+// estimated to visit at most 10^maxExactLogNodes nodes, and a beam it picks
+// is made as wide as lets it evaluate about beamWork candidate schedules
+void EventScheduler::setAutoThresholds(double maxExactLogNodes, size_t beamWork) {
+	this -> autoExactLimit = maxExactLogNodes;
+	this -> autoBeamWork = beamWork;
+}
+
 // buildConflicts
-// generate the conflicts graph all at once
+// bring the conflicts graph up to date with the list of sections; only the
+// conflicts of sections added since the last call are calculated
 void EventScheduler::buildConflicts() {
+	static LatencyHistogram& latency =
+		Metrics::global().histogram("scheduler.conflicts");
+	ScopedLatency timer(latency);
 
-	// reset, then preallocate the conflicts vector
 	size_t nSections = this -> sections.size();
-	this -> conflicts.clear();
+	size_t nBuilt = this -> conflicts.size();
+
+	// widen the rows that were already built
+	for (auto& sectionConflicts: this -> conflicts) {
+		sectionConflicts.resize(nSections);
+	}
 	this -> conflicts.reserve(nSections);
 
-	// find the conflicts for each section
-	for (size_t i = 0; i < nSections; ++i) {
+	// find the conflicts for each new section
+	for (size_t i = nBuilt; i < nSections; ++i) {
 
-		// preallocate the vector to hold the section's conflicts
-		std::vector<bool> sectionConflicts(nSections, false);
+		// preallocate the bitset to hold the section's conflicts, reusing a
+		// spare row if there is one
+		Bitset sectionConflicts;
+		if (!this -> spareConflicts.empty()) {
+			sectionConflicts = std::move(this -> spareConflicts.back());
+			this -> spareConflicts.pop_back();
+		}
+		sectionConflicts.assign(nSections, false);
 		auto section = this -> sections[i].section;
 
-		// reuse what was calculated for previous sections
-		for (size_t j = 0; j < i; ++j) {
-			sectionConflicts[j] = this -> conflicts[j][i];
+		// calculate conflicts with the sections built before, and record them
+		// in their rows as well
+		for (size_t j = 0; j < nBuilt; ++j) {
+			if (section -> intersects(*this -> sections[j].section)) {
+				sectionConflicts.set(j);
+				this -> conflicts[j].set(i);
+			}
+		}
+
+		// reuse what was calculated for previous new sections
+		for (size_t j = nBuilt; j < i; ++j) {
+			if (this -> conflicts[j].test(i)) {
+				sectionConflicts.set(j);
+			}
 		}
 
 		// conflicts with self
-		sectionConflicts[i] = true;
+		sectionConflicts.set(i);
 
 		// calculate conflicts with unprocessed sections
 		for (size_t j = i + 1; j < nSections; ++j) {
-			sectionConflicts[j] = section -> intersects(*this -> sections[j].section);
+			if (section -> intersects(*this -> sections[j].section)) {
+				sectionConflicts.set(j);
+			}
+		}
+
+		this -> conflicts.push_back(std::move(sectionConflicts));
+	}
+
+	// sections of a bundle that are not linked conflict with each other; the
+	// sections of a bundle are added together, so a bundle with any new
+	// section has only new sections
+	for (auto& bundle: this -> bundleComponents) {
+		if (this -> eventSectionRanges.at(bundle.second.back()).second > nBuilt) {
+			this -> linkBundle(bundle.first, nBuilt);
+		}
+	}
+}
+
+// linkBundle
+// add the conflicts between the sections of two components of a bundle that
+// may not be taken together according to the links of the bundle
+void EventScheduler::linkBundle(unsigned int id, size_t nBuilt) {
+
+	const std::vector<unsigned int>& components = this -> bundleComponents.at(id);
+	const std::vector<BundleLink>& links = this -> bundleLinks.at(id);
+
+	// the components that have links between them, and the linked pairs of
+	// section indices
+	std::set<std::pair<unsigned int, unsigned int>> linkedComponents;
+	std::set<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int>>
+		linkedSections;
+	for (auto& link: links) {
+		linkedComponents.insert({link.component, link.otherComponent});
+		linkedComponents.insert({link.otherComponent, link.component});
+		linkedSections.insert({link.component, link.section,
+			link.otherComponent, link.otherSection});
+		linkedSections.insert({link.otherComponent, link.otherSection,
+			link.component, link.section});
+	}
+
+	for (auto [first, second]: linkedComponents) {
+		auto firstRange = this -> eventSectionRanges.at(components.at(first));
+		auto secondRange = this -> eventSectionRanges.at(components.at(second));
+		for (SectionID i = std::max(firstRange.first, nBuilt);
+			i < firstRange.second; ++i) {
+
+			for (SectionID j = secondRange.first; j < secondRange.second; ++j) {
+				if (!linkedSections.count({first, this -> sections[i].sectionIndex,
+					second, this -> sections[j].sectionIndex})) {
+
+					this -> conflicts[i].set(j);
+				}
+			}
+		}
+	}
+}
+
+// bundleFits
+// whether the components of a bundle after the one at position depth can all
+// still be scheduled with the given domain
+bool EventScheduler::bundleFits(const SearchOrder& order, size_t depth,
+	const Bitset& domain) const {
+
+	const SearchEvent& ev = order.events[depth];
+	size_t end = depth - ev.component + ev.nComponents;
+	for (size_t i = depth + 1; i < end; ++i) {
+		if (!domain.anyInRange(order.events[i].begin, order.events[i].end)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// listSearchEvents
+// list the events in the order they should be branched on: required events
+// first, so that schedules that cannot fit them fail as early as possible,
+// then highest weight first. The components of a bundle follow its first
+// component
+std::vector<EventScheduler::SearchEvent> EventScheduler::listSearchEvents() const {
+
+	// the event, or first component of the bundle, for everything to schedule
+	std::vector<SearchEvent> heads;
+	std::vector<const std::vector<unsigned int> *> components;
+	for (auto& ew: this -> eventsToSchedule.getElements()) {
+
+		auto bundle = this -> bundleComponents.find(ew.id);
+		components.push_back(bundle == this -> bundleComponents.end()
+			? nullptr : &bundle -> second);
+		unsigned int headID = components.back() ? components.back() -> front() : ew.id;
+		unsigned int nComponents = components.back()
+			? (unsigned int)components.back() -> size() : 1;
+
+		// only the sections that were registered for the event are searched
+		auto range = this -> eventSectionRanges.at(headID);
+		heads.push_back({headID, ew.weight, range.first, range.second,
+			ew.required, 0, nComponents});
+	}
+
+	std::vector<size_t> order(heads.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&heads](size_t lhsIndex, size_t rhsIndex) {
+		const SearchEvent& lhs = heads[lhsIndex];
+		const SearchEvent& rhs = heads[rhsIndex];
+		if (lhs.required != rhs.required) {
+			return lhs.required;
+		}
+		return lhs.weight > rhs.weight
+			|| (lhs.weight == rhs.weight && lhs.begin < rhs.begin);
+	});
+
+	std::vector<SearchEvent> searchEvents;
+	for (size_t i: order) {
+		searchEvents.push_back(heads[i]);
+		for (unsigned int c = 1; c < heads[i].nComponents; ++c) {
+			unsigned int componentID = (*components[i])[c];
+			auto range = this -> eventSectionRanges.at(componentID);
+			searchEvents.push_back({componentID, 0, range.first, range.second,
+				heads[i].required, c, heads[i].nComponents});
+		}
+	}
+
+	return searchEvents;
+}
+
+// buildSearchOrder
+// search the given events in the given order, recording for every one of
+// their sections which of the events it can take sections away from; requires
+// the conflicts graph to be built
+EventScheduler::SearchOrder EventScheduler::buildSearchOrder(
+	const std::vector<SearchEvent>& searchEvents) const {
+
+	SearchOrder order = {searchEvents, {}, 0};
+	while (order.nRequired < order.events.size()
+		&& order.events[order.nRequired].required) {
+
+		++order.nRequired;
+	}
+
+	// an event is touched by a section if any of its sections conflict with
+	// it; only sections of the searched events are ever added
+	order.touched.resize(this -> sections.size());
+	for (auto& ev: order.events) {
+		for (SectionID sec = ev.begin; sec < ev.end; ++sec) {
+			for (size_t i = 0; i < order.events.size(); ++i) {
+				if (this -> conflicts[sec].anyInRange(order.events[i].begin,
+					order.events[i].end)) {
+
+					order.touched[sec].push_back(i);
+				}
+			}
+		}
+	}
+
+	return order;
+}
+
+// makeRootSchedule
+// create the empty schedule that every search starts from: every section is
+// available, and every event with at least one section can add its weight. If
+// a required event has no sections the bound is -infinity, which cuts every
+// search right away
+EventScheduler::ScheduleWrapper EventScheduler::makeRootSchedule(
+	const SearchOrder& order) const {
+
+	double bound = 0;
+	for (auto& ev: order.events) {
+		if (ev.begin < ev.end) {
+			bound += std::max(ev.weight, 0.0);
+		}
+		else if (ev.required) {
+			bound = -std::numeric_limits<double>::infinity();
+			break;
+		}
+	}
+
+	return {0, bound, {}, Bitset(this -> sections.size(), true),
+		WeekOccupancy(this -> dayLength)};
+}
+
+// addToWeek
+// add the intervals of a section to the week, and return how much the section
+// changes the score of a schedule: its weight less the weighted cost the
+// objectives charge for each of its intervals
+double EventScheduler::addToWeek(WeekOccupancy& week, SectionID sec) const {
+	double change = this -> sections[sec].weight;
+	if (this -> objectives.empty()) {
+		return change;
+	}
+
+	const IntervalGroup& section = *this -> sections[sec].section;
+	for (unsigned int i = 0; i < section.getIntervalSize(); ++i) {
+		auto interval = section.getInterval(i);
+		for (auto& objective: this -> objectives) {
+			change -= objective.second
+				* objective.first -> delta(week, interval.first, interval.second);
+		}
+		week.add(interval.first, interval.second);
+	}
+
+	return change;
+}
+
+// recoverable
+// the most that adding more sections to the week could raise the score by
+// lowering the cost of the objectives
+double EventScheduler::recoverable(const WeekOccupancy& week) const {
+	double total = 0;
+	for (auto& objective: this -> objectives) {
+		total += objective.second * objective.first -> recoverable(week);
+	}
+	return total;
+}
+
+// lostBound
+// the weight that can no longer be added by the events after position depth
+// when sec is added to a schedule, i.e. the events whose domain was not
+// empty in before but is empty in after. Losing a required event, or a
+// component of a bundle whose first component is in the schedule, loses an
+// infinite weight, so the schedule is cut by the usual bound checks
+double EventScheduler::lostBound(const SearchOrder& order, size_t depth,
+	const Bitset& before, const Bitset& after, SectionID sec) const {
+
+	double lost = 0;
+	for (size_t i: order.touched[sec]) {
+		const SearchEvent& ev = order.events[i];
+		if (i > depth && before.anyInRange(ev.begin, ev.end)
+			&& !after.anyInRange(ev.begin, ev.end)) {
+
+			if (ev.required || (ev.component > 0 && i - ev.component <= depth)) {
+				return std::numeric_limits<double>::infinity();
+			}
+			lost += std::max(ev.weight, 0.0);
+		}
+	}
+
+	return lost;
+}
+
+// toResult
+// convert a schedule into the return format, where each entry contains
+// first the event id and second the section index
+std::vector<std::pair<unsigned int, unsigned int>> EventScheduler::toResult(
+	const std::vector<SectionID>& sched) const {
+
+	std::vector<std::pair<unsigned int, unsigned int>> retSched;
+	for (SectionID secID: sched) {
+		retSched.push_back({
+			this -> sections.at(secID).eventID,
+			this -> sections.at(secID).sectionIndex
+		});
+	}
+
+	return retSched;
+}
+
+// toResults
+// convert every schedule in a pool into the return format, best first
+std::vector<std::vector<std::pair<unsigned int, unsigned int>>>
+	EventScheduler::toResults(const SchedulePool& pool) const {
+
+	std::vector<std::vector<std::pair<unsigned int, unsigned int>>> retScheds;
+	for (size_t i = 0; i < pool.size(); ++i) {
+		retScheds.push_back(this -> toResult(pool.getSchedule(i)));
+	}
+
+	return retScheds;
+}
+
+// Incumbent constructor for a portfolio build that has found no schedule yet
+EventScheduler::Incumbent::Incumbent() :
+	score(-std::numeric_limits<double>::infinity()),
+	stop(false) {}
+
+// SchedulePool constructor; a pool keeps at least one schedule, and schedules
+// always differ in at least one section
+EventScheduler::SchedulePool::SchedulePool(size_t k, unsigned int minDifference) :
+	maxSchedules(std::max(k, (size_t)1)),
+	minDiff(std::max(minDifference, 1u)),
+	entries(),
+	shared(nullptr) {}
+
+// share
+// make the pool take part in a portfolio build: schedules it accepts raise the
+// shared incumbent, and its threshold never falls below the incumbent, so
+// that its search prunes with the best schedule of any solver. Only pools of
+// one schedule may share an incumbent
+void EventScheduler::SchedulePool::share(Incumbent * incumbent) {
+	this -> shared = incumbent;
+}
+
+// stopped
+// whether the search filling the pool should stop, because another solver of
+// the portfolio finished or the deadline passed
+bool EventScheduler::SchedulePool::stopped() const {
+	return this -> shared != nullptr
+		&& this -> shared -> stop.load(std::memory_order_relaxed);
+}
+
+// distance
+// the number of sections that are in one of two sorted schedules but not in
+// the other; counting stops once it reaches minDiff
+unsigned int EventScheduler::SchedulePool::distance(
+	const std::vector<SectionID>& lhs, const std::vector<SectionID>& rhs) const {
+
+	unsigned int dist = 0;
+	size_t i = 0;
+	size_t j = 0;
+	while ((i < lhs.size() || j < rhs.size()) && dist < this -> minDiff) {
+		if (j == rhs.size() || (i < lhs.size() && lhs[i] < rhs[j])) {
+			++dist;
+			++i;
+		}
+		else if (i == lhs.size() || rhs[j] < lhs[i]) {
+			++dist;
+			++j;
 		}
+		else {
+			++i;
+			++j;
+		}
+	}
+
+	return dist;
+}
+
+// threshold
+// the score a schedule must exceed to be added to the pool; searches can cut
+// every branch that cannot exceed it
+double EventScheduler::SchedulePool::threshold() const {
+	double own = this -> entries.size() < this -> maxSchedules
+		? -std::numeric_limits<double>::infinity()
+		: this -> entries.back().score;
+	if (this -> shared != nullptr) {
+		return std::max(own,
+			this -> shared -> score.load(std::memory_order_relaxed));
+	}
+	return own;
+}
+
+// offer
+// add a schedule to the pool if it is among the best; a schedule that is too
+// similar to a schedule in the pool only replaces it if it is better.
+// Returns whether the schedule was added
+bool EventScheduler::SchedulePool::offer(double score,
+	const std::vector<SectionID>& sched) {
+
+	if (score <= this -> threshold()) {
+		return false;
+	}
+
+	std::vector<SectionID> sorted = sched;
+	std::sort(sorted.begin(), sorted.end());
+
+	// find the schedules that are too similar; they must all be worse
+	std::vector<size_t> similar;
+	for (size_t i = 0; i < this -> entries.size(); ++i) {
+		if (this -> distance(sorted, this -> entries[i].sorted) < this -> minDiff) {
+			if (this -> entries[i].score >= score) {
+				return false;
+			}
+			similar.push_back(i);
+		}
+	}
 
-		this -> conflicts.push_back(sectionConflicts);
+	for (auto it = similar.rbegin(); it != similar.rend(); ++it) {
+		this -> entries.erase(this -> entries.begin() + (long)*it);
 	}
+
+	// insert behind the schedules of equal or greater score, then drop the
+	// worst schedule if the pool is over capacity
+	auto pos = std::find_if(this -> entries.begin(), this -> entries.end(),
+		[score](const Entry& entry) { return entry.score < score; });
+	this -> entries.insert(pos, {score, sched, sorted});
+	if (this -> entries.size() > this -> maxSchedules) {
+		this -> entries.pop_back();
+	}
+
+	// raise the incumbent, unless another solver raised it past the score
+	if (this -> shared != nullptr) {
+		double incumbent = this -> shared -> score.load();
+		while (incumbent < score
+			&& !this -> shared -> score.compare_exchange_weak(incumbent, score)) {}
+	}
+
+	return true;
+}
+
+// size
+// the number of schedules in the pool
+size_t EventScheduler::SchedulePool::size() const {
+	return this -> entries.size();
+}
+
+// getScore
+// the score of the schedule at an index; index 0 is the best schedule
+double EventScheduler::SchedulePool::getScore(size_t index) const {
+	return this -> entries.at(index).score;
+}
+
+// getSchedule
+// the sections of the schedule at an index; index 0 is the best schedule
+const std::vector<EventScheduler::SectionID>&
+	EventScheduler::SchedulePool::getSchedule(size_t index) const {
+
+	return this -> entries.at(index).sched;
 }
 
 // display
@@ -156,13 +1030,16 @@ void EventScheduler::display(std::ostream& os) const {
 
 			// list each conflict in format Event XXX Section XXX
 			SectionID secID = this -> getSectionID(eventID, i);
+			if (secID == NO_SECTION || secID >= this -> conflicts.size()) {
+				continue;
+			}
 			std::cout << secID << std::endl;
 			os << "\t\tConflicts: ";
 			for (SectionID conflictID = 0;
 				conflictID < this -> conflicts.at(secID).size();
 				++conflictID) {
 				
-				if (this -> conflicts.at(secID).at(conflictID)) {
+				if (this -> conflicts.at(secID).test(conflictID)) {
 					int conflictEventID = this -> sections[conflictID].eventID;
 					unsigned int conflictSectionID =
 						this -> sections[conflictID].sectionIndex;
@@ -177,200 +1054,1097 @@ void EventScheduler::display(std::ostream& os) const {
 }
 
 
-// buildOptimalSchedule
-// use a simple approach that tries to add classes in priority order
-// return the best schedule found in a vector where each entry contains
-// first the event id and second the section index
-// This is effectively a brute force attempt to find the independent set of the
-// conflicts graph that has the largest combined weight
-std::vector<std::pair<unsigned int, unsigned int>> EventScheduler::buildOptimalSchedule() {
+// searchExact
+// depth first branch and bound over the events in order; domains[depth] holds
+// the sections still compatible with the sections in path, week summarizes
+// them for the objectives, and bound is an upper bound on the weight the
+// events from depth onward can add. Every schedule visited is offered to the
+// pool, and a branch is cut as soon as it can no longer make it into the pool
+void EventScheduler::searchExact(const SearchOrder& order, size_t depth,
+	double score, double bound, const WeekOccupancy& week,
+	std::vector<Bitset>& domains, std::vector<SectionID>& path,
+	SchedulePool& pool) const {
 
-	this -> buildConflicts();
+	if (pool.stopped()) {
+		return;
+	}
 
-	// copy the unscheduled events so that we don't overwrite the class member
-	//auto unscheduled = this -> eventsToSchedule;
-	std::priority_queue<EventWrapper> unscheduled;
-	for (auto& unschedEvent: this -> eventsToSchedule.getElements()) {
-		unscheduled.push(unschedEvent);
+	// every partial schedule that has all of the required events, and no
+	// bundle that is only partly scheduled, is a valid schedule since optional
+	// events may always be left out
+	if (depth >= order.nRequired && score > pool.threshold()
+		&& (depth == order.events.size() || order.events[depth].component == 0)) {
+
+		pool.offer(score, path);
 	}
 
-	std::vector<ScheduleWrapper> schedules = {{0, {}}};
+	double recovered = this -> recoverable(week);
+	if (depth == order.events.size()
+		|| score + bound + recovered <= pool.threshold()) {
 
-	while (!unscheduled.empty()) {
+		return;
+	}
 
-		// remove highest priority event
-		EventWrapper ew = unscheduled.top();
-		unscheduled.pop();
+	const SearchEvent& ev = order.events[depth];
+	const Bitset& domain = domains[depth];
+	bool schedulable = domain.anyInRange(ev.begin, ev.end);
+	double skipBound = schedulable ? bound - std::max(ev.weight, 0.0) : bound;
+
+	// attempt to add each section of the event that is still in the domain
+	for (SectionID secID = ev.begin; schedulable && secID < ev.end; ++secID) {
+		if (!domains[depth].test(secID)) {
+			continue;
+		}
+
+		// narrow the domains of the remaining events, and cut the branch if
+		// it can no longer lead to a better schedule
+		domains[depth + 1].assignAndNot(domains[depth], this -> conflicts[secID]);
+		if (!this -> bundleFits(order, depth, domains[depth + 1])) {
+			continue;
+		}
+		double newBound = skipBound - this -> lostBound(order, depth,
+			domains[depth], domains[depth + 1], secID);
+		WeekOccupancy newWeek = week;
+		double newScore = score + this -> addToWeek(newWeek, secID);
+		if (newScore + newBound + this -> recoverable(newWeek)
+			<= pool.threshold()) {
+
+			continue;
+		}
+
+		path.push_back(secID);
+		this -> searchExact(order, depth + 1, newScore, newBound, newWeek,
+			domains, path, pool);
+		path.pop_back();
+	}
+
+	// leave the event out of the schedule; the schedule itself has already
+	// been offered to the pool. Required events cannot be left out, and
+	// neither can components of a bundle whose first component was scheduled,
+	// which are the only ones that still have sections. Leaving out the first
+	// component of a bundle leaves out the other components as well
+	if (ev.required || (ev.component > 0 && schedulable)) {
+		return;
+	}
+	domains[depth + 1] = domains[depth];
+	for (size_t i = depth + 1; ev.component == 0 && i < depth + ev.nComponents; ++i) {
+		domains[depth + 1].resetRange(order.events[i].begin, order.events[i].end);
+	}
+	this -> searchExact(order, depth + 1, score, skipBound, week, domains, path,
+		pool);
+}
+
+// adaptWidth
+// the number of candidates the beam keeps after branching on the event at
+// depth when the adaptive width is enabled; maxWidth otherwise. Every round
+// gets an even share of what is left of the budget, given the sections of the
+// next event. The share is stretched, up to twice its size, to keep together
+// the candidates whose score is within a tenth of a standard deviation of the
+// last one it would keep, since cutting through near ties decides the outcome
+// arbitrarily. It is also stretched to keep about minWidth schedules alive if
+// the share of the evaluated candidates that survive holds
+size_t EventScheduler::adaptWidth(const SearchOrder& order, size_t depth,
+	const std::pmr::vector<ScheduleWrapper>& candidates, size_t nEvaluated,
+	size_t workDone, unsigned int maxWidth) const {
+
+	if (this -> adaptiveBudget == 0 || depth + 1 == order.events.size()
+		|| candidates.empty()) {
+
+		return maxWidth;
+	}
+
+	// the even share of the rest of the budget
+	const SearchEvent& next = order.events[depth + 1];
+	size_t roundsLeft = order.events.size() - depth - 1;
+	size_t costPerSchedule = next.end - next.begin + 1;
+	size_t budgetLeft = workDone < this -> adaptiveBudget
+		? this -> adaptiveBudget - workDone : 0;
+	size_t share = std::clamp(budgetLeft / (roundsLeft * costPerSchedule),
+		(size_t)1, (size_t)maxWidth);
+
+	// the dispersion of the candidates' scores, and the score of the last
+	// candidate the share would keep
+	std::vector<double> scores;
+	scores.reserve(candidates.size());
+	double mean = 0;
+	for (auto& candidate: candidates) {
+		scores.push_back(candidate.score);
+		mean += candidate.score;
+	}
+	mean /= (double)scores.size();
+	double variance = 0;
+	for (double score: scores) {
+		variance += (score - mean) * (score - mean);
+	}
+	double spread = std::sqrt(variance / (double)scores.size());
+
+	size_t last = std::min(share, scores.size()) - 1;
+	std::nth_element(scores.begin(), scores.begin() + (long)last, scores.end(),
+		std::greater<double>());
+	double cutoff = scores[last] - 0.1 * spread;
+	size_t nTied = (size_t)std::count_if(scores.begin(), scores.end(),
+		[cutoff](double score) { return score >= cutoff; });
+
+	// keep more schedules when few of the candidates survive
+	double survived = (double)candidates.size() / (double)nEvaluated;
+	size_t nAlive = (size_t)std::ceil(this -> adaptiveMinWidth / survived);
+
+	return std::min(std::max(nTied, nAlive),
+		std::min(2 * share, (size_t)maxWidth));
+}
+
+// beamSearch
+// branch on the events in order like searchExact, but only keep the
+// maxConsidered schedules that rank highest every round. Every schedule
+// created is offered to the pool, and schedules that can no longer make it
+// into the pool are dropped so they do not take up space in the beam.
+// upperBound is set to an upper bound on the score of any schedule that could
+// still make it into the pool: the bounds of the schedules in the beam and of
+// those the beam had no room for. The search stops as soon as the pool
+// reaches it, since the pool then provably holds the best schedules. Returns
+// the schedules left in the beam at the end
+std::vector<std::vector<EventScheduler::SectionID>> EventScheduler::beamSearch(
+	const SearchOrder& order, unsigned int maxConsidered,
+	SchedulePool& pool, double& upperBound) const {
+
+	// the domains of candidate schedules come from this thread's arena, and
+	// are all freed at once when the search is done
+	ScratchArena& arena = ScratchArena::local();
+	ScratchArena::Scope scratch(arena);
+
+	// initialize the schedules with an empty schedule
+	TopElemsHeap<ScheduleWrapper> schedules(maxConsidered);
+	ScheduleWrapper rootSchedule = this -> makeRootSchedule(order);
+	if (order.nRequired == 0) {
+		pool.offer(rootSchedule.score, {});
+	}
+	schedules.push(rootSchedule);
+
+	// a set of schedules where we have attempted to add the new section;
+	// preallocate the maximum size required for a slight performance boost
+	std::pmr::vector<ScheduleWrapper> newSchedules(&arena);
+	newSchedules.reserve((this -> maxSecPerEvent + 1) * maxConsidered);
+
+	// scratch space for the domain, week and sections of a candidate
+	// schedule, so that they are only copied for candidates that are kept
+	Bitset domain;
+	WeekOccupancy week(this -> dayLength);
+	std::vector<SectionID> candidate;
+
+	// the largest bound of the schedules that did not fit in the beam
+	double dropped = -std::numeric_limits<double>::infinity();
+	upperBound = std::numeric_limits<double>::infinity();
+
+	// the number of candidate schedules evaluated, in total and this round,
+	// which the adaptive width budgets
+	size_t workDone = 0;
+	size_t nEvaluated = 0;
+
+	for (size_t depth = 0; depth < order.events.size(); ++depth) {
+
+		// stop once no schedule in or out of the beam can beat the pool; a
+		// search that was stopped by a portfolio proves nothing
+		if (pool.stopped()) {
+			upperBound = std::numeric_limits<double>::infinity();
+			break;
+		}
+		upperBound = dropped;
+		for (auto& schedule: schedules.getElements()) {
+			upperBound = std::max(upperBound, schedule.score + schedule.bound
+				+ this -> recoverable(schedule.week));
+		}
+		if (upperBound <= pool.threshold()) {
+			break;
+		}
+
+		const SearchEvent& ev = order.events[depth];
 
-		// a set of schedules where we have attempted to add the new section
-		std::vector<ScheduleWrapper> newSchedules;
-		
 		// go through each schedule and attempt to modify it
-		for (auto& schedule: schedules) {
+		for (auto& schedule: schedules.getMutElements()) {
+
+			bool schedulable = schedule.domain.anyInRange(ev.begin, ev.end);
+			double skipBound = schedulable
+				? schedule.bound - std::max(ev.weight, 0.0)
+				: schedule.bound;
 
 			// attempt to add each section the event to the schedule
-			for (unsigned int i = 0; i < ew.event.size(); ++i) {
-				
-				SectionID secID = this -> getSectionID(ew.id, i);
+			for (SectionID secID = ev.begin; schedulable && secID < ev.end;
+				++secID) {
+
 				// check if the section can be added to the schedule without
 				// creating conflicts
-				if (!this -> sectionConflictsWithSchedule(schedule.sched,
-					secID)) {
-					
-					// create a new schedule and add it to our list
-					Schedule newSchedule = schedule.sched;
-					newSchedule.queue(secID);
-					newSchedule.flushQueue();
-					double newWeight = schedule.weight + ew.weight;
-					newSchedules.push_back({newWeight, newSchedule});
+				if (!schedule.domain.test(secID)) {
+					continue;
+				}
+				++nEvaluated;
+
+				domain.assignAndNot(schedule.domain, this -> conflicts[secID]);
+				if (!this -> bundleFits(order, depth, domain)) {
+					continue;
 				}
+				week = schedule.week;
+				double newScore = schedule.score + this -> addToWeek(week, secID);
+				double newBound = skipBound - this -> lostBound(order, depth,
+					schedule.domain, domain, secID);
+
+				// keep track of the best schedules seen that have all of the
+				// required events and no partly scheduled bundle
+				if (depth + 1 >= order.nRequired && newScore > pool.threshold()
+					&& (depth + 1 == order.events.size()
+					|| order.events[depth + 1].component == 0)) {
+
+					candidate.assign(schedule.sched.getArray(),
+						schedule.sched.getArray() + schedule.sched.getSize());
+					candidate.push_back(secID);
+					pool.offer(newScore, candidate);
+				}
+
+				// drop the candidate if it is doomed to do no better
+				if (newScore + newBound + this -> recoverable(week)
+					<= pool.threshold()) {
+
+					continue;
+				}
+
+				// create a new schedule and add it to our list
+				Schedule newSchedule = schedule.sched;
+				newSchedule.queue(secID);
+				newSchedules.push_back({newScore, newBound, newSchedule,
+					Bitset(domain, &arena), week});
+			}
+
+			// the schedule itself stays as the option of skipping the event,
+			// which is one more candidate; skipping a required event, or a
+			// component of a bundle that was started, leaves no feasible
+			// schedule, so the bound of -infinity drops it. Skipping the first
+			// component of a bundle skips the other components as well
+			++nEvaluated;
+			schedule.bound = ev.required || (ev.component > 0 && schedulable)
+				? -std::numeric_limits<double>::infinity()
+				: skipBound;
+			for (size_t i = depth + 1; ev.component == 0
+				&& i < depth + ev.nComponents; ++i) {
+
+				schedule.domain.resetRange(order.events[i].begin,
+					order.events[i].end);
+			}
+			if (schedule.score + schedule.bound
+				+ this -> recoverable(schedule.week) > pool.threshold()) {
+
+				newSchedules.push_back(std::move(schedule));
+			}
+		}
+
+		// keep only the best of the old and new schedules, remembering the
+		// bound of those that are dropped
+		size_t width = this -> adaptWidth(order, depth, newSchedules,
+			nEvaluated, workDone, maxConsidered);
+		workDone += nEvaluated;
+		nEvaluated = 0;
+		if (newSchedules.size() > width) {
+			auto firstDropped = newSchedules.begin() + (long)width;
+			std::nth_element(newSchedules.begin(), firstDropped,
+				newSchedules.end(), std::greater<ScheduleWrapper>());
+			for (auto it = firstDropped; it != newSchedules.end(); ++it) {
+				dropped = std::max(dropped,
+					it -> score + it -> bound + this -> recoverable(it -> week));
+			}
+			newSchedules.erase(firstDropped, newSchedules.end());
+		}
+		schedules.clear();
+		schedules.pushRange(std::make_move_iterator(newSchedules.begin()),
+			std::make_move_iterator(newSchedules.end()));
+
+		// write the latest changes to all the schedules that were kept
+		for (auto& schedule: schedules.getMutElements()) {
+			schedule.sched.flushQueue();
+		}
+
+		newSchedules.clear();
+	}
+
+	// the schedules left after the last event have all been offered to the
+	// pool, and no event is left to add to them
+	if (upperBound > pool.threshold() && !pool.stopped()) {
+		upperBound = dropped;
+		for (auto& schedule: schedules.getElements()) {
+			upperBound = std::max(upperBound, schedule.score);
+		}
+	}
+
+	std::vector<std::vector<SectionID>> kept;
+	for (auto& schedule: schedules.getElements()) {
+		kept.push_back(std::vector<SectionID>(schedule.sched.getArray(),
+			schedule.sched.getArray() + schedule.sched.getSize()));
+	}
+
+	return kept;
+}
+
+// searchAround
+// fix the given sections, leaving out any that conflict with sections fixed
+// before them, then search the events that are not fixed and could still be
+// added exactly; every schedule found is offered to the pool. If more than
+// maxFree events could still be added, only the fixed schedule is offered
+void EventScheduler::searchAround(const std::vector<SearchEvent>& searchEvents,
+	const std::unordered_map<unsigned int, size_t>& position,
+	const std::vector<SectionID>& fixedSections, size_t maxFree,
+	SchedulePool& pool) const {
+
+	// fix the sections; the components of a bundle are only fixed together,
+	// so a second pass leaves out the bundles that were only partly fixed.
+	// Leaving them out only frees sections, so every other bundle stays fixed
+	Bitset domain;
+	std::vector<bool> isFixed;
+	std::vector<bool> leaveFree(searchEvents.size(), false);
+	std::vector<SectionID> path;
+	WeekOccupancy week(this -> dayLength);
+	double score = 0;
+	for (int pass = 0; pass < 2; ++pass) {
+
+		domain = Bitset(this -> sections.size(), true);
+		isFixed.assign(searchEvents.size(), false);
+		path.clear();
+		week = WeekOccupancy(this -> dayLength);
+		score = 0;
+		for (SectionID secID: fixedSections) {
+			auto found = position.find(
+				this -> searchEventID(this -> sections[secID].eventID));
+			if (found == position.end() || isFixed[found -> second]
+				|| leaveFree[found -> second] || !domain.test(secID)) {
+
+				continue;
+			}
+
+			domain.andNot(this -> conflicts[secID]);
+			isFixed[found -> second] = true;
+			path.push_back(secID);
+			score += this -> addToWeek(week, secID);
+		}
+
+		bool partlyFixed = false;
+		for (size_t i = 0; i < searchEvents.size(); i += searchEvents[i].nComponents) {
+			size_t end = i + searchEvents[i].nComponents;
+			size_t nFixed = (size_t)std::count(isFixed.begin() + (long)i,
+				isFixed.begin() + (long)end, true);
+			if (nFixed > 0 && nFixed < end - i) {
+				std::fill(leaveFree.begin() + (long)i, leaveFree.begin() + (long)end,
+					true);
+				partlyFixed = true;
 			}
 		}
+		if (!partlyFixed) {
+			break;
+		}
+	}
+
+	// the neighbourhood is every event that is not fixed and can still be
+	// scheduled around the fixed sections, with all the components of a
+	// bundle or none of them; there is no schedule if a required event is
+	// neither fixed nor schedulable
+	std::vector<SearchEvent> neighbourhood;
+	double bound = 0;
+	bool allRequiredFixed = true;
+	for (size_t i = 0; i < searchEvents.size(); i += searchEvents[i].nComponents) {
+		size_t end = i + searchEvents[i].nComponents;
+		if (isFixed[i]) {
+			continue;
+		}
+
+		bool schedulable = true;
+		for (size_t j = i; j < end; ++j) {
+			schedulable = schedulable
+				&& domain.anyInRange(searchEvents[j].begin, searchEvents[j].end);
+		}
 
-		// augment the schedules already made with the new ones
-		schedules.insert(schedules.end(), newSchedules.begin(), newSchedules.end());
+		if (schedulable) {
+			neighbourhood.insert(neighbourhood.end(),
+				searchEvents.begin() + (long)i, searchEvents.begin() + (long)end);
+			bound += std::max(searchEvents[i].weight, 0.0);
+		}
+		else if (searchEvents[i].required) {
+			return;
+		}
+		allRequiredFixed = allRequiredFixed && !searchEvents[i].required;
+	}
 
-#ifdef EVENTSCHEDULER_DEBUG
-		std::cout << schedules.size() <<std::endl;
-#endif
+	if (neighbourhood.size() > maxFree) {
+		if (allRequiredFixed && score > pool.threshold()) {
+			pool.offer(score, path);
+		}
+		return;
 	}
 
-#ifdef EVENTSCHEDULER_DEBUG
-	// debugging -- print candidate schedules
-	std::cout << "Potential schedules" << std::endl;
-	for (auto& sched: schedules) {
-		std::cout << "\tweight = " << sched.weight << ": ";
+	if (score + bound + this -> recoverable(week) <= pool.threshold()) {
+		return;
+	}
 
-		for (SectionID secID: sched.sched) {
-			std::cout << "Event " << (int)(secID >> 32) << " Section " <<
-				(unsigned int)(secID) << ", ";
+	// search the neighbourhood exactly
+	SearchOrder order = this -> buildSearchOrder(neighbourhood);
+	std::vector<Bitset> domains(neighbourhood.size() + 1, domain);
+	this -> searchExact(order, 0, score, bound, week, domains, path, pool);
+}
+
+// improveSchedule
+// large neighbourhood search over a finished search: every round, a random
+// subset of the events in the best schedule of the pool are freed, the sections
+// of the other events are fixed, and the freed events together with every
+// unscheduled event that could now be added are searched exactly; every
+// schedule found is offered to the pool
+void EventScheduler::improveSchedule(const std::vector<SearchEvent>& searchEvents,
+	SchedulePool& pool) const {
+
+	auto start = std::chrono::steady_clock::now();
+	std::mt19937 rng(this -> improveSeed);
+
+	// lookup from event ids to their position in the list of events
+	std::unordered_map<unsigned int, size_t> position;
+	for (size_t i = 0; i < searchEvents.size(); ++i) {
+		position[searchEvents[i].id] = i;
+	}
+
+	for (unsigned int round = 0; round < this -> improveIterations; ++round) {
+
+		// stop once the time limit has been reached
+		std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now() - start;
+		if (this -> improveTimeLimit > 0
+			&& elapsed.count() >= this -> improveTimeLimit) {
+
+			break;
+		}
+
+		if (pool.size() == 0 || pool.stopped()) {
+			break;
 		}
 
-		std::cout << std::endl;
+		std::vector<SectionID> current = pool.getSchedule(0);
+		size_t nScheduled = current.size();
+		if (nScheduled == 0) {
+			break;
+		}
+
+		// move a random subset of the scheduled sections to the front; those
+		// are the ones that get freed, and the rest stay fixed
+		size_t nFree = std::min((size_t)this -> improveNeighbourhood, nScheduled);
+		for (size_t i = 0; i < nFree; ++i) {
+			std::uniform_int_distribution<size_t> pick(i, nScheduled - 1);
+			std::swap(current[i], current[pick(rng)]);
+		}
+		current.erase(current.begin(), current.begin() + (long)nFree);
+
+		this -> searchAround(searchEvents, position, current, SIZE_MAX, pool);
+	}
+}
+
+// extendSchedules
+// warm start from the schedules remembered from the last build: each one is
+// translated to the current sections (dropping events that were removed), and
+// the events it leaves out that could now be added, such as newly added
+// events, are searched exactly around it. Every schedule found is offered to
+// the pool
+void EventScheduler::extendSchedules(const std::vector<SearchEvent>& searchEvents,
+	SchedulePool& pool) const {
+
+	// lookup from event ids to their position in the list of events
+	std::unordered_map<unsigned int, size_t> position;
+	for (size_t i = 0; i < searchEvents.size(); ++i) {
+		position[searchEvents[i].id] = i;
 	}
-#endif
 
-	// find the best schedule
-	size_t bestIndex = 0;
-	double bestWeight = 0;
-	for (size_t i = 0; i < schedules.size(); ++i) {
+	std::vector<SectionID> fixedSections;
+	for (auto& previous: this -> warmSchedules) {
 
-		if (schedules[i].weight > bestWeight) {
-			bestIndex = i;
-			bestWeight = schedules[i].weight;
+		fixedSections.clear();
+		for (auto& [eventID, sectionIndex]: previous) {
+			if (position.count(this -> searchEventID(eventID)) == 0) {
+				continue;
+			}
+
+			SectionID secID = this -> getSectionID(eventID, sectionIndex);
+			if (secID != NO_SECTION) {
+				fixedSections.push_back(secID);
+			}
 		}
+
+		this -> searchAround(searchEvents, position, fixedSections,
+			WARM_START_MAX_FREE, pool);
 	}
+}
 
-	// convert that schedule into the return format
-	std::vector<std::pair<unsigned int, unsigned int>> retSched;
+// fitRequired
+// find a schedule with every required event using an exact search over just
+// the required events, which stops as soon as one is found since they all
+// have the same weight (unless the objectives tell them apart); the events left out of it are then searched exactly
+// around it if there are few enough. The schedules found are offered to the
+// pool, which stays empty if the required events do not fit
+void EventScheduler::fitRequired(const SearchOrder& order,
+	SchedulePool& pool) const {
+
+	std::vector<SearchEvent> required(order.events.begin(),
+		order.events.begin() + (long)order.nRequired);
+	SearchOrder requiredOrder = this -> buildSearchOrder(required);
+	ScheduleWrapper root = this -> makeRootSchedule(requiredOrder);
+	std::vector<Bitset> domains(required.size() + 1, root.domain);
+	std::vector<SectionID> path;
+
+	SchedulePool fits(1);
+	this -> searchExact(requiredOrder, 0, 0, root.bound, root.week, domains,
+		path, fits);
+	if (fits.size() == 0) {
+		return;
+	}
 
-	Schedule bestSched = schedules[bestIndex].sched;
-	size_t nSections = bestSched.getSize();
-	const SectionID * secIDs = bestSched.getArray();
+	std::unordered_map<unsigned int, size_t> position;
+	for (size_t i = 0; i < order.events.size(); ++i) {
+		position[order.events[i].id] = i;
+	}
+	this -> searchAround(order.events, position, fits.getSchedule(0),
+		WARM_START_MAX_FREE, pool);
+}
 
-	for (size_t i = 0; i < nSections; ++i) {
-		SectionID secID = secIDs[i];
+// buildOptimalSchedule
+// find the schedule with the largest combined weight, i.e. the independent set
+// of the conflicts graph with the largest combined weight. Events are branched
+// on in priority order; every time a section is added the domains of the
+// remaining events are narrowed with its conflicts row, so branches where
+// events lose all of their sections are recognized (and cut) immediately
+// return the best schedule found in a vector where each entry contains
+// first the event id and second the section index; the schedule is empty,
+// and isFeasible returns false, if the required events do not fit
+std::vector<std::pair<unsigned int, unsigned int>> EventScheduler::buildOptimalSchedule() {
+	auto results = this -> buildOptimalSchedules(1);
+	return results.empty() ? std::vector<std::pair<unsigned int, unsigned int>>()
+		: results.front();
+}
 
-		retSched.push_back({
-			this -> sections.at(secID).eventID,
-			this -> sections.at(secID).sectionIndex
-		});
+// buildOptimalSchedules
+// find the k schedules with the largest combined weight in a single search,
+// best first; no two of the schedules differ in fewer than minDiff sections
+std::vector<std::vector<std::pair<unsigned int, unsigned int>>>
+	EventScheduler::buildOptimalSchedules(size_t k, unsigned int minDiff) {
+
+	static LatencyHistogram& latency =
+		Metrics::global().histogram("scheduler.build.optimal");
+	ScopedLatency timer(latency);
+
+	if (k == 0) {
+		return {};
 	}
 
+	this -> buildConflicts();
+	SearchOrder order = this -> buildSearchOrder(this -> listSearchEvents());
 
-	return retSched;
+	// one domain per depth of the search so that they are only allocated once
+	ScheduleWrapper root = this -> makeRootSchedule(order);
+	std::vector<Bitset> domains(order.events.size() + 1, root.domain);
+	std::vector<SectionID> path;
+	path.reserve(order.events.size());
+
+	SchedulePool pool(k, minDiff);
+	this -> searchExact(order, 0, 0, root.bound, root.week, domains, path, pool);
+
+	this -> optimal = true;
+	this -> optimalityGap = 0;
+	this -> feasible = pool.size() > 0;
+	return this -> toResults(pool);
 }
 
 // buildApproxSchedule
 // use the same technique as buildOptimalSchedule, but limit the number of
-// schedules under consideration every round
+// schedules under consideration every round; schedules that can no longer
+// beat the best schedule found so far are dropped so they do not take up
+// space in the beam. If an improvement phase was set with setImprovementPhase,
+// it is run on the result of the beam
 std::vector<std::pair<unsigned int, unsigned int>> EventScheduler::buildApproxSchedule(
 	unsigned int maxConsidered) {
 
+	auto results = this -> buildApproxSchedules(1, 1, maxConsidered);
+	return results.empty() ? std::vector<std::pair<unsigned int, unsigned int>>()
+		: results.front();
+}
+
+// buildApproxSchedules
+// find up to k good schedules with a single beam search, best first; no two of
+// the schedules differ in fewer than minDiff sections. Unless disabled with
+// setWarmStart, the schedules from the previous call are extended with any
+// events added since before the beam search is run, and the beam is skipped
+// when that already fills the pool with schedules that reach the upper bound
+std::vector<std::vector<std::pair<unsigned int, unsigned int>>>
+	EventScheduler::buildApproxSchedules(size_t k, unsigned int minDiff,
+	unsigned int maxConsidered) {
+
+	static LatencyHistogram& latency =
+		Metrics::global().histogram("scheduler.build.approx");
+	ScopedLatency timer(latency);
+
+	if (k == 0) {
+		return {};
+	}
+
+	this -> buildConflicts();
+	SearchOrder order = this -> buildSearchOrder(this -> listSearchEvents());
+
+	SchedulePool pool(k, minDiff);
+
+	// start from the schedules of the last build; if extending them already
+	// fills the pool with schedules that reach the upper bound of the root there
+	// is no need for a fresh search
+	std::vector<std::vector<SectionID>> beam;
+	if (this -> warmStart) {
+		this -> extendSchedules(order.events, pool);
+	}
+	double upperBound = this -> makeRootSchedule(order).bound;
+	if (pool.threshold() < upperBound) {
+		beam = this -> beamSearch(order, maxConsidered, pool, upperBound);
+	}
+
+	// the beam can drop every schedule that fits the required events; if so,
+	// settle whether the required events fit with an exact search over just
+	// them, and extend the schedule it finds. If it finds none, no schedule
+	// exists, which is as good as the search can do
+	if (pool.size() == 0 && order.nRequired > 0) {
+		this -> fitRequired(order, pool);
+		if (pool.size() == 0) {
+			upperBound = -std::numeric_limits<double>::infinity();
+		}
+	}
+
+	// optionally improve the result of the beam, unless it is already known
+	// to be the best
+	if (this -> improveIterations > 0 && upperBound > pool.threshold()) {
+		this -> improveSchedule(order.events, pool);
+	}
+
+	// remember the schedules for the next build
+	this -> warmSchedules.clear();
+	if (this -> warmStart) {
+		for (size_t i = 0; i < pool.size(); ++i) {
+			this -> warmSchedules.push_back(this -> toResult(pool.getSchedule(i)));
+		}
+		for (auto& sched: beam) {
+			this -> warmSchedules.push_back(this -> toResult(sched));
+		}
+	}
+
+	// the pool holds the best schedules if nothing left unexplored could
+	// beat them; otherwise report how far the worst of them could be from
+	// the best schedule that was not found
+	this -> optimal = upperBound <= pool.threshold();
+	this -> optimalityGap = this -> optimal ? 0 : upperBound - pool.threshold();
+	this -> feasible = pool.size() > 0;
+	return this -> toResults(pool);
+}
+
+// buildPortfolioSchedule
+// race several solvers on their own threads and return the best schedule any
+// of them finds: an exact branch and bound, which proves optimality on small
+// problems, a greedy beam that finds a good schedule quickly, and a beam of
+// width maxConsidered followed by the improvement phase if one was set. They
+// share the score of the best schedule found so far and prune with it. The
+// build returns as soon as a solver proves its schedule optimal, when all of
+// them finish, or once deadlineMs milliseconds have passed (0 for no
+// deadline); isOptimal and getOptimalityGap tell which happened
+std::vector<std::pair<unsigned int, unsigned int>>
+	EventScheduler::buildPortfolioSchedule(double deadlineMs,
+	unsigned int maxConsidered) {
+
+	static LatencyHistogram& latency =
+		Metrics::global().histogram("scheduler.build.portfolio");
+	ScopedLatency timer(latency);
+
+	auto deadline = std::chrono::steady_clock::now()
+		+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double, std::milli>(deadlineMs));
+
+	// the solvers only read the problem, so it is brought up to date first
 	this -> buildConflicts();
+	SearchOrder order = this -> buildSearchOrder(this -> listSearchEvents());
+	ScheduleWrapper root = this -> makeRootSchedule(order);
+
+	Incumbent incumbent;
 
-	// copy the unscheduled events so that we don't overwrite the class member
-	//auto unscheduled = this -> eventsToSchedule;
-	std::priority_queue<EventWrapper> unscheduled;
-	for (auto& unschedEvent: this -> eventsToSchedule.getElements()) {
-		unscheduled.push(unschedEvent);
+	// the schedules of the last build give the first incumbent
+	SchedulePool warm(1);
+	warm.share(&incumbent);
+	if (this -> warmStart) {
+		this -> extendSchedules(order.events, warm);
 	}
 
-	// initialize the schedules with an empty schedule
-	TopElemsHeap<ScheduleWrapper> schedules(maxConsidered);
-	ScheduleWrapper rootSchedule = {0, {}};
-	schedules.push(rootSchedule);
+	// one pool and bound per solver; the upper bounds of the beams are only
+	// valid if they were not stopped
+	const size_t nSolvers = 3;
+	std::vector<SchedulePool> pools(nSolvers, SchedulePool(1));
+	for (auto& pool: pools) {
+		pool.share(&incumbent);
+	}
+	std::vector<double> upperBounds(nSolvers,
+		std::numeric_limits<double>::infinity());
+	std::vector<std::vector<SectionID>> beam;
+
+	std::mutex lock;
+	std::condition_variable finished;
+	size_t nFinished = 0;
+	bool proved = false;
+	auto finish = [&](bool solved) {
+		std::lock_guard<std::mutex> guard(lock);
+		++nFinished;
+		proved = proved || solved;
+		finished.notify_one();
+	};
+
+	std::vector<std::thread> solvers;
+	solvers.emplace_back([&]() {
+		std::vector<Bitset> domains(order.events.size() + 1, root.domain);
+		std::vector<SectionID> path;
+		this -> searchExact(order, 0, 0, root.bound, root.week, domains, path,
+			pools[0]);
+		finish(!pools[0].stopped());
+	});
+	solvers.emplace_back([&]() {
+		this -> beamSearch(order, 1, pools[1], upperBounds[1]);
+		finish(upperBounds[1] <= pools[1].threshold());
+	});
+	solvers.emplace_back([&]() {
+		beam = this -> beamSearch(order, maxConsidered, pools[2], upperBounds[2]);
+		bool solved = upperBounds[2] <= pools[2].threshold();
+		if (!solved && this -> improveIterations > 0) {
+			this -> improveSchedule(order.events, pools[2]);
+		}
+		finish(solved);
+	});
+
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		auto over = [&]() { return proved || nFinished == nSolvers; };
+		if (deadlineMs > 0) {
+			finished.wait_until(guard, deadline, over);
+		}
+		else {
+			finished.wait(guard, over);
+		}
+	}
+	incumbent.stop = true;
+	for (auto& solver: solvers) {
+		solver.join();
+	}
 
-	// a set of schedules where we have attempted to add the new section;
-	// preallocate the maximum size required for a slight performance boost
-	std::vector<ScheduleWrapper> newSchedules;
-	newSchedules.reserve(this -> maxSecPerEvent * maxConsidered);
+	// the best schedule is in whichever pool raised the incumbent last
+	pools.push_back(warm);
+	const SchedulePool * best = nullptr;
+	for (auto& pool: pools) {
+		if (pool.size() > 0 && (best == nullptr
+			|| pool.getScore(0) > best -> getScore(0))) {
 
-	while (!unscheduled.empty()) {
+			best = &pool;
+		}
+	}
+	double bestScore = best != nullptr ? best -> getScore(0)
+		: -std::numeric_limits<double>::infinity();
+
+	this -> optimal = proved;
+	this -> optimalityGap = 0;
+	if (!proved) {
+		double bound = std::min(upperBounds[1], upperBounds[2]);
+		this -> optimalityGap = std::max(bound - bestScore, 0.0);
+	}
+	this -> feasible = best != nullptr;
 
-		// remove highest priority event
-		EventWrapper ew = unscheduled.top();
-		unscheduled.pop();
-		
-		// go through each schedule and attempt to modify it
-		for (auto schedule: schedules.getElements()) {
+	std::vector<std::pair<unsigned int, unsigned int>> result;
+	if (best != nullptr) {
+		result = this -> toResult(best -> getSchedule(0));
+	}
 
-			// attempt to add each section the event to the schedule
-			for (unsigned int i = 0; i < ew.event.size(); ++i) {
-				
-				SectionID secID = this -> getSectionID(ew.id, i);
-				// check if the section can be added to the schedule without
-				// creating conflicts
-				if (!this -> sectionConflictsWithSchedule(schedule.sched,
-					secID)) {
-					
-					// create a new schedule and add it to our list
-					Schedule newSchedule = schedule.sched;
-					newSchedule.queue(secID);
-					double newWeight = schedule.weight + ew.weight;
-					newSchedules.push_back({newWeight, newSchedule});
+	this -> warmSchedules.clear();
+	if (this -> warmStart) {
+		if (best != nullptr) {
+			this -> warmSchedules.push_back(result);
+		}
+		for (auto& sched: beam) {
+			this -> warmSchedules.push_back(this -> toResult(sched));
+		}
+	}
+
+	return result;
+}
+
+// chooseSolver
+// estimate how hard the problem is and pick a solver for it. With d the share
+// of pairs of sections of different events that conflict, the event at
+// position i of the search order keeps about n (1 - d)^i of its n sections
+// once the events before it are scheduled, so an exact search visits about
+// the product of (1 + n (1 - d)^i) nodes; the components of a bundle are
+// counted like events, since their links are conflicts too. If no two events
+// conflict and there are no objectives, taking the best section of every
+// event is optimal, which a beam of width 1 does
+EventScheduler::SolverChoice EventScheduler::chooseSolver() {
+	this -> buildConflicts();
+	SearchOrder order = this -> buildSearchOrder(this -> listSearchEvents());
+
+	size_t nSections = 0;
+	double nPairs = 0;
+	double nConflicts = 0;
+	for (auto& ev: order.events) {
+		nSections += ev.end - ev.begin;
+	}
+	for (auto& ev: order.events) {
+		size_t n = ev.end - ev.begin;
+		nPairs += (double)n * (double)(nSections - n);
+		for (SectionID secID = ev.begin; secID < ev.end; ++secID) {
+			nConflicts += (double)(this -> conflicts[secID].count()
+				- this -> conflicts[secID].countInRange(ev.begin, ev.end));
+		}
+	}
+	double density = nPairs > 0 ? nConflicts / nPairs : 0;
+
+	double logNodes = 0;
+	double kept = 1;
+	for (auto& ev: order.events) {
+		logNodes += std::log10(1 + (double)(ev.end - ev.begin) * kept);
+		kept *= 1 - density;
+	}
+
+	SolverChoice choice = {SolverChoice::BEAM, logNodes, density, 0};
+	if (nConflicts == 0 && this -> objectives.empty()) {
+		choice.solver = SolverChoice::GREEDY;
+		choice.width = 1;
+	}
+	else if (logNodes <= this -> autoExactLimit) {
+		choice.solver = SolverChoice::EXACT;
+	}
+	else {
+		size_t perSchedule = std::max(nSections + order.events.size(), (size_t)1);
+		choice.width = (unsigned int)std::clamp(this -> autoBeamWork / perSchedule,
+			(size_t)16, (size_t)2000);
+	}
+
+	return choice;
+}
+
+// getSolverChoice
+// the choice autoSchedule made the last time it was called
+const EventScheduler::SolverChoice& EventScheduler::getSolverChoice() const {
+	return this -> solverChoice;
+}
+
+// autoSchedule
+// build a schedule with the solver chooseSolver picks; the choice is kept so
+// that it can be checked with getSolverChoice
+std::vector<std::pair<unsigned int, unsigned int>> EventScheduler::autoSchedule() {
+	this -> solverChoice = this -> chooseSolver();
+	if (this -> solverChoice.solver == SolverChoice::EXACT) {
+		return this -> buildOptimalSchedule();
+	}
+
+	// the greedy fast path is a beam of width 1
+	return this -> buildApproxSchedule(this -> solverChoice.width);
+}
+
+// BitsetHash
+// hash function for occupancy masks
+size_t EventScheduler::BitsetHash::operator()(const Bitset& bits) const {
+	return bits.hash();
+}
+
+// buildSlotMasks
+// split the week into distinct slots and describe every searched section by
+// the slots it occupies; times that are covered by exactly the same sections
+// are merged into one slot. Returns false if more than maxSlots slots are
+// needed, or if the masks would not agree with the conflicts graph
+bool EventScheduler::buildSlotMasks(const std::vector<SearchEvent>& searchEvents,
+	size_t maxSlots, std::vector<Bitset>& masks) const {
+
+	// every start and end time splits the week into elementary slots
+	std::vector<double> times;
+	for (auto& ev: searchEvents) {
+		for (SectionID secID = ev.begin; secID < ev.end; ++secID) {
+			const IntervalGroup * section = this -> sections[secID].section;
+			for (unsigned int i = 0; i < section -> getIntervalSize(); ++i) {
+				times.push_back(section -> getInterval(i).first);
+				times.push_back(section -> getInterval(i).second);
+			}
+		}
+	}
+	std::sort(times.begin(), times.end());
+	times.erase(std::unique(times.begin(), times.end()), times.end());
+
+	// find the sections that cover each elementary slot
+	size_t nSections = this -> sections.size();
+	size_t nElementary = times.size() > 0 ? times.size() - 1 : 0;
+	std::vector<Bitset> covers(nElementary, Bitset(nSections, false));
+	for (auto& ev: searchEvents) {
+		for (SectionID secID = ev.begin; secID < ev.end; ++secID) {
+			const IntervalGroup * section = this -> sections[secID].section;
+			for (unsigned int i = 0; i < section -> getIntervalSize(); ++i) {
+				auto interval = section -> getInterval(i);
+				size_t first = (size_t)(std::lower_bound(times.begin(),
+					times.end(), interval.first) - times.begin());
+				size_t last = (size_t)(std::lower_bound(times.begin(),
+					times.end(), interval.second) - times.begin());
+				for (size_t k = first; k < last; ++k) {
+					covers[k].set(secID);
 				}
 			}
 		}
+	}
 
-		// augment the schedules already made with the new ones
-		for (auto& schedule: newSchedules) {
-			schedules.push(schedule);
+	// elementary slots covered by the same sections cannot be told apart, so
+	// they become one distinct slot
+	std::unordered_map<Bitset, size_t, BitsetHash> distinct;
+	std::vector<size_t> slotOf(nElementary, NO_SECTION);
+	for (size_t k = 0; k < nElementary; ++k) {
+		if (covers[k].any()) {
+			slotOf[k] = distinct.insert({covers[k], distinct.size()}).first -> second;
 		}
+	}
 
-		// write the latest changes to all the schedules that were kept
-		for (auto& schedule: schedules.getMutElements()) {
-			schedule.sched.flushQueue();
+	if (distinct.size() > maxSlots) {
+		return false;
+	}
+
+	masks.assign(nSections, Bitset(distinct.size(), false));
+	std::vector<SectionID> searched;
+	for (auto& ev: searchEvents) {
+		for (SectionID secID = ev.begin; secID < ev.end; ++secID) {
+			searched.push_back(secID);
+		}
+	}
+	for (size_t k = 0; k < nElementary; ++k) {
+		for (SectionID secID: searched) {
+			if (covers[k].test(secID)) {
+				masks[secID].set(slotOf[k]);
+			}
 		}
+	}
 
-		newSchedules.clear();
+	// the masks can only stand in for the conflicts graph if they agree with
+	// it, which is not the case for intervals of zero length
+	for (size_t i = 0; i < searched.size(); ++i) {
+		for (size_t j = i + 1; j < searched.size(); ++j) {
+			if (this -> conflicts[searched[i]].test(searched[j])
+				!= masks[searched[i]].intersects(masks[searched[j]])) {
+
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// searchSlots
+// the largest weight that the events from depth onward can add to a schedule
+// that occupies the given slots. Only the slots that the remaining events can
+// still use are kept in occupied, so partial schedules that leave the same
+// relevant occupancy share one entry of the memoization table. The weight is
+// -infinity if the required events from depth onward do not fit
+double EventScheduler::searchSlots(const std::vector<SearchEvent>& searchEvents,
+	const std::vector<Bitset>& masks, const std::vector<Bitset>& futureSlots,
+	size_t depth, const Bitset& occupied, std::vector<SlotTable>& memo) const {
+
+	if (depth == searchEvents.size()) {
+		return 0;
+	}
+
+	auto found = memo[depth].find(occupied);
+	if (found != memo[depth].end()) {
+		return found -> second.weight;
 	}
 
-	// find the best schedule
-	size_t bestIndex = 0;
-	double bestWeight = 0;
-	for (size_t i = 0; i < schedules.getElements().size(); ++i) {
+	const SearchEvent& ev = searchEvents[depth];
+
+	// leave the event out, unless it is required
+	Bitset next = occupied;
+	SlotEntry entry = {-std::numeric_limits<double>::infinity(), NO_SECTION};
+	if (!ev.required) {
+		next &= futureSlots[depth + 1];
+		entry.weight = this -> searchSlots(searchEvents, masks, futureSlots,
+			depth + 1, next, memo);
+	}
+
+	// attempt to add each section that fits in the free slots
+	for (SectionID secID = ev.begin; secID < ev.end; ++secID) {
+		if (masks[secID].intersects(occupied)) {
+			continue;
+		}
+
+		next = occupied;
+		next |= masks[secID];
+		next &= futureSlots[depth + 1];
+		double weight = this -> sections[secID].weight + this -> searchSlots(
+			searchEvents, masks, futureSlots, depth + 1, next, memo);
 
-		if (schedules.getElements()[i].weight > bestWeight) {
-			bestIndex = i;
-			bestWeight = schedules.getElements()[i].weight;
+		if (weight > entry.weight) {
+			entry = {weight, secID};
 		}
 	}
 
-	// convert that schedule into the return format
-	std::vector<std::pair<unsigned int, unsigned int>> retSched;
-	Schedule bestSched = schedules.getElements()[bestIndex].sched;
-	size_t nSections = bestSched.getSize();
-	const SectionID * secIDs = bestSched.getArray();
+	memo[depth].insert({occupied, entry});
+	return entry.weight;
+}
 
-	for (size_t i = 0; i < nSections; ++i) {
-		SectionID secID = secIDs[i];
+// buildSlotSchedule
+// find the schedule with the largest combined weight with a dynamic program
+// over the events and the slots of the week they occupy; many partial
+// schedules leave the same occupancy for the remaining events, and each such
+// occupancy is only solved once. This needs the week to split into at most
+// maxSlots distinct slots; otherwise buildOptimalSchedule is used instead
+std::vector<std::pair<unsigned int, unsigned int>> EventScheduler::buildSlotSchedule(
+	size_t maxSlots) {
 
-		retSched.push_back({
-			this -> sections.at(secID).eventID,
-			this -> sections.at(secID).sectionIndex
-		});
+	static LatencyHistogram& latency =
+		Metrics::global().histogram("scheduler.build.slot");
+	ScopedLatency timer(latency);
+
+	this -> buildConflicts();
+	std::vector<SearchEvent> searchEvents = this -> listSearchEvents();
+
+	// the occupancy of the week does not tell whether a bundle was started,
+	// and the links of bundles are not times of the week; nor does it tell
+	// the cost of the objectives, which depends on where classes fall in a day
+	if (!this -> bundleComponents.empty() || !this -> objectives.empty()) {
+		return this -> buildOptimalSchedule();
 	}
 
-	return retSched;
-}
\ No newline at end of file
+	std::vector<Bitset> masks;
+	if (!this -> buildSlotMasks(searchEvents, maxSlots, masks)) {
+		return this -> buildOptimalSchedule();
+	}
+
+	// the slots that can still be used by the events from each depth onward
+	size_t nSlots = masks.size() > 0 ? masks[0].size() : 0;
+	std::vector<Bitset> futureSlots(searchEvents.size() + 1,
+		Bitset(nSlots, false));
+	for (size_t depth = searchEvents.size(); depth-- > 0;) {
+		futureSlots[depth] = futureSlots[depth + 1];
+		for (SectionID secID = searchEvents[depth].begin;
+			secID < searchEvents[depth].end; ++secID) {
+
+			futureSlots[depth] |= masks[secID];
+		}
+	}
+
+	// a best weight of -infinity means the required events do not fit
+	std::vector<SlotTable> memo(searchEvents.size());
+	Bitset occupied(nSlots, false);
+	this -> optimal = true;
+	this -> optimalityGap = 0;
+	this -> feasible = this -> searchSlots(searchEvents, masks, futureSlots, 0,
+		occupied, memo) > -std::numeric_limits<double>::infinity();
+	if (!this -> feasible) {
+		return {};
+	}
+
+	// follow the memoized choices to recover the schedule
+	std::vector<SectionID> sched;
+	for (size_t depth = 0; depth < searchEvents.size(); ++depth) {
+		SectionID choice = memo[depth].at(occupied).choice;
+		if (choice != NO_SECTION) {
+			sched.push_back(choice);
+			occupied |= masks[choice];
+		}
+		occupied &= futureSlots[depth + 1];
+	}
+
+	return this -> toResult(sched);
+}
@@ -41,6 +41,24 @@ int main() {
     }
     std::cout << std::endl;
 
+    // the time indexed dynamic program should find a schedule of equal weight
+    auto slotSchedule = eventSched.buildSlotSchedule();
+    std::cout << "Time indexed schedule: ";
+    for (auto evSec: slotSchedule) {
+        std::cout << "Event " << evSec.first << " Section " << evSec.second << ", ";
+    }
+    std::cout << std::endl;
+
+    // show the three best alternatives that differ in at least two sections
+    std::cout << "Alternative schedules:" << std::endl;
+    for (auto& alternative: eventSched.buildOptimalSchedules(3, 2)) {
+        std::cout << "\t";
+        for (auto evSec: alternative) {
+            std::cout << "Event " << evSec.first << " Section " << evSec.second << ", ";
+        }
+        std::cout << std::endl;
+    }
+
 
     /* ----------- Input that is poor for optimal scheduilng --------------- */
 
@@ -66,5 +84,208 @@ int main() {
     }
     std::cout << std::endl;
 
+    /* ------- Narrow beam followed by the improvement phase ------------- */
+
+    // with a beam of width 1 the schedule depends on which sections were
+    // picked first; the improvement phase re-solves a few events at a time
+    EventScheduler eventSched3;
+    EventScheduler eventSched4;
+    eventSched4.setImprovementPhase(100, 3);
+    for (int i = 0; i < 12; ++i) {
+        std::vector<IntervalGroup> sections;
+        for (int j = 0; j < 3; ++j) {
+            sections.push_back(
+                IntervalGroup({{(i + 5 * j) % 24, (i + 5 * j) % 24 + 1.5}})
+            );
+        }
+
+        eventSched3.addEvent(Event(sections), i, 1 + i % 3);
+        eventSched4.addEvent(Event(sections), i, 1 + i % 3);
+    }
+
+    // Display the total weight of both schedules
+    int weight3 = 0;
+    for (auto evSec: eventSched3.buildApproxSchedule(1)) {
+        weight3 += 1 + evSec.first % 3;
+    }
+    int weight4 = 0;
+    for (auto evSec: eventSched4.buildApproxSchedule(1)) {
+        weight4 += 1 + evSec.first % 3;
+    }
+    std::cout << std::endl << "Beam of width 1: weight " << weight3
+        << ", with improvement phase: weight " << weight4 << std::endl;
+
+    /* ------- Re-solving after events are added and removed ------------- */
+
+    // the scheduler remembers its last schedules; removing an event and
+    // adding another only builds the conflicts of the new sections, and the
+    // next build starts from the previous schedules
+    eventSched4.removeEvent(4);
+    eventSched4.addEvent(Event({IntervalGroup({{30, 31}})}), 12, 3);
+
+    std::cout << std::endl << "Schedule after replacing event 4 with event 12: ";
+    for (auto evSec: eventSched4.buildApproxSchedule(1)) {
+        std::cout << "Event " << evSec.first << " Section " << evSec.second << ", ";
+    }
+    std::cout << std::endl;
+
+    /* ------- Excluded times ------------------------------------------- */
+
+    // sections that overlap an excluded time are removed before any search,
+    // so their events have to use their other sections
+    eventSched4.addExclusion(IntervalGroup({{0, 6}}));
+
+    std::cout << std::endl << "Schedule with times 0 to 6 excluded: ";
+    for (auto evSec: eventSched4.buildApproxSchedule(1)) {
+        std::cout << "Event " << evSec.first << " Section " << evSec.second << ", ";
+    }
+    std::cout << std::endl;
+
+    /* ------- Required events ------------------------------------------ */
+
+    // a required event is in every schedule, even if it pushes out events
+    // with a larger weight; required events that cannot all fit leave no
+    // schedule at all
+    EventScheduler eventSched5;
+    eventSched5.addEvent(Event({IntervalGroup({{1, 3}})}), 0, 5);
+    eventSched5.addEvent(Event({IntervalGroup({{2, 4}})}), 1, 1, true);
+
+    std::cout << std::endl << "Schedule with required event 1: ";
+    for (auto evSec: eventSched5.buildOptimalSchedule()) {
+        std::cout << "Event " << evSec.first << " Section " << evSec.second << ", ";
+    }
+    std::cout << std::endl;
+
+    eventSched5.addEvent(Event({IntervalGroup({{3, 5}})}), 2, 1, true);
+    eventSched5.buildOptimalSchedule();
+    std::cout << "Feasible with required events 1 and 2: "
+        << (eventSched5.isFeasible() ? "yes" : "no") << std::endl;
+
+    /* ------- Choice groups -------------------------------------------- */
+
+    // at most one member of a choice group is scheduled; the group is
+    // searched as a single event, and the schedule names the chosen member
+    EventScheduler eventSched6;
+    eventSched6.addEvent(Event({IntervalGroup({{1, 3}})}), 0, 2);
+    eventSched6.addChoiceGroup({
+        {Event({IntervalGroup({{2, 4}})}), 1, 4},
+        {Event({IntervalGroup({{4, 6}}), IntervalGroup({{0, 1}})}), 2, 3},
+        {Event({IntervalGroup({{6, 8}})}), 3, 1}
+    }, 100);
+
+    std::cout << std::endl << "Schedule with a choice group: ";
+    for (auto evSec: eventSched6.buildOptimalSchedule()) {
+        std::cout << "Event " << evSec.first << " Section " << evSec.second << ", ";
+    }
+    std::cout << std::endl;
+
+    /* ------- Linked bundles ------------------------------------------- */
+
+    // a lecture and a lab are scheduled together or not at all; lab
+    // section 0 belongs to lecture section 0, and lab section 1 to lecture
+    // section 1, so only two of the four combinations may be taken
+    EventScheduler eventSched7;
+    eventSched7.addEvent(Event({IntervalGroup({{1, 2}})}), 0, 1);
+    eventSched7.addBundle({
+        {Event({IntervalGroup({{1, 2}}), IntervalGroup({{3, 4}})}), 1},
+        {Event({IntervalGroup({{5, 6}}), IntervalGroup({{7, 8}})}), 2}
+    }, {{0, 0, 1, 0}, {0, 1, 1, 1}}, 101, 3);
+
+    std::cout << std::endl << "Schedule with a lecture and lab bundle: ";
+    for (auto evSec: eventSched7.buildOptimalSchedule()) {
+        std::cout << "Event " << evSec.first << " Section " << evSec.second << ", ";
+    }
+    std::cout << std::endl;
+
+    /* ------- Soft objectives ------------------------------------------ */
+
+    // times are minutes from the start of Monday; the objectives prefer the
+    // sections that start at 8 a.m. or later, leave Friday free and keep the
+    // gaps between classes short, at the cost of a hundredth per minute
+    EventScheduler eventSched8;
+    eventSched8.addObjective(std::make_shared<EarlyStartObjective>(480));
+    eventSched8.addObjective(std::make_shared<FreeDayObjective>(4));
+    eventSched8.addObjective(std::make_shared<GapObjective>(), 0.01);
+    eventSched8.addEvent(Event({IntervalGroup({{450, 500}}),
+        IntervalGroup({{600, 650}})}), 0, 2);
+    eventSched8.addEvent(Event({IntervalGroup({{660, 710}}),
+        IntervalGroup({{900, 950}})}), 1, 2);
+    eventSched8.addEvent(Event({IntervalGroup({{6360, 6410}}),
+        IntervalGroup({{2040, 2090}})}), 2, 2);
+
+    std::cout << std::endl << "Schedule with soft objectives: ";
+    for (auto evSec: eventSched8.buildOptimalSchedule()) {
+        std::cout << "Event " << evSec.first << " Section " << evSec.second << ", ";
+    }
+    std::cout << std::endl;
+
+    /* ------- Optimality of approximate builds ------------------------- */
+
+    // the beam stops as soon as no schedule it left unexplored could beat
+    // the best one found, and otherwise reports how much better one could be
+    eventSched8.buildApproxSchedule(1);
+    std::cout << std::endl << "Beam of width 1 optimal: "
+        << (eventSched8.isOptimal() ? "yes" : "no") << ", gap "
+        << eventSched8.getOptimalityGap() << std::endl;
+
+    /* ------- Adaptive beam width -------------------------------------- */
+
+    // the beam evaluates at most 100 candidate schedules in total, keeping
+    // up to 50 each round where the scores are close
+    eventSched8.setAdaptiveBeam(100, 2);
+    std::cout << std::endl << "Schedule with an adaptive beam: ";
+    for (auto evSec: eventSched8.buildApproxSchedule(50)) {
+        std::cout << "Event " << evSec.first << " Section " << evSec.second << ", ";
+    }
+    std::cout << std::endl;
+
+    /* ------- Portfolio of solvers ------------------------------------- */
+
+    // exact and beam solvers race on their own threads for at most 100 ms;
+    // on a problem this small the exact search proves its schedule optimal
+    std::cout << std::endl << "Schedule from a portfolio of solvers: ";
+    for (auto evSec: eventSched8.buildPortfolioSchedule(100)) {
+        std::cout << "Event " << evSec.first << " Section " << evSec.second << ", ";
+    }
+    std::cout << std::endl << "Portfolio optimal: "
+        << (eventSched8.isOptimal() ? "yes" : "no") << std::endl;
+
+    /* ------- Automatic solver selection ------------------------------- */
+
+    // autoSchedule estimates the size of the search and picks a solver
+    const char * solverNames[] = {"exact", "greedy", "beam"};
+    eventSched8.autoSchedule();
+    auto choice = eventSched8.getSolverChoice();
+    std::cout << std::endl << "Solver picked: " << solverNames[choice.solver]
+        << ", estimated log10 nodes " << choice.logNodes
+        << ", conflict density " << choice.conflictDensity << std::endl;
+
+    /* ------- Reusing schedulers --------------------------------------- */
+
+    // a scheduler checked out of the thread's pool is reset and returned
+    // when its lease ends, so the next checkout gets the same one back with
+    // no events, but with its capacity
+    const EventScheduler * firstLeased = nullptr;
+    for (int request = 0; request < 2; ++request) {
+        EventScheduler::Lease leased = EventScheduler::checkout();
+        leased -> addEvent(Event({IntervalGroup({{0, 5}}),
+            IntervalGroup({{5, 10}})}), 0);
+        leased -> addEvent(Event({IntervalGroup({{0, 5}})}), 1);
+
+        std::cout << std::endl << "Schedule from leased scheduler " << request
+            << ": ";
+        for (auto evSec: leased -> buildOptimalSchedule()) {
+            std::cout << "Event " << evSec.first << " Section " << evSec.second << ", ";
+        }
+        if (request == 0) {
+            firstLeased = &*leased;
+        }
+        else {
+            std::cout << std::endl << "Same scheduler reused: "
+                << (firstLeased == &*leased ? "yes" : "no");
+        }
+        std::cout << std::endl;
+    }
+
     return 0;
 }
\ No newline at end of file
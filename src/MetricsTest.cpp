@@ -0,0 +1,65 @@
+// MetricsTest.cpp
+// Test the LatencyHistogram and Metrics classes - checks counts, that
+// percentiles are within the precision of the buckets, and that histograms
+// can be recorded to from several threads at once
+
+#include "Metrics.h"
+#include <thread>
+#include <vector>
+#include <cmath>
+
+int main() {
+
+    // record the latencies 1 to 100000 ns once each
+    LatencyHistogram histogram;
+    for (uint64_t nanos = 1; nanos <= 100000; ++nanos) {
+        histogram.record(nanos);
+    }
+    std::cout << "count (expected 100000): " << histogram.getCount()
+        << std::endl;
+    std::cout << "mean (expected 50000.5): " << histogram.getMean()
+        << std::endl;
+    std::cout << "max (expected 100000): " << histogram.getMax() << std::endl;
+
+    // the buckets split every power of two 16 ways, so a percentile is never
+    // off by more than a sixteenth
+    bool withinPrecision = true;
+    for (double p: {0.01, 0.5, 0.9, 0.99, 0.999}) {
+        double exact = p * 100000;
+        double reported = (double)histogram.getPercentile(p);
+        withinPrecision = withinPrecision
+            && std::abs(reported - exact) <= exact / 16 + 1;
+    }
+    std::cout << "percentiles within 1/16 (expected 1): " << withinPrecision
+        << std::endl;
+
+    // small values get a bucket each
+    LatencyHistogram small;
+    small.record(3);
+    small.record(7);
+    std::cout << "median of 3 and 7 (expected 3): " << small.getPercentile(0.4)
+        << std::endl;
+
+    // record to a registry's histogram from several threads
+    Metrics metrics;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&metrics]() {
+            LatencyHistogram& shared = metrics.histogram("shared");
+            for (int i = 0; i < 10000; ++i) {
+                ScopedLatency timer(shared);
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    std::cout << "shared count (expected 40000): "
+        << metrics.histogram("shared").getCount() << std::endl;
+
+    metrics.reset();
+    std::cout << "count after reset (expected 0): "
+        << metrics.histogram("shared").getCount() << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+// ScratchArenaTest.cpp
+// Test the ScratchArena class - checks that scopes reset the arena, that the
+// buffer grows to fit the largest build, and that sets allocated from it
+// behave like any other
+
+#include "ScratchArena.h"
+#include "Bitset.h"
+#include <iostream>
+
+int main() {
+
+    // a small arena, so that the first build does not fit in its buffer
+    ScratchArena arena(256);
+
+    // a build that allocates a few sets from the arena
+    for (int build = 0; build < 3; ++build) {
+        ScratchArena::Scope scope(arena);
+        std::pmr::vector<Bitset> sets(&arena);
+        for (size_t i = 0; i < 20; ++i) {
+            sets.emplace_back(200, false);
+            sets.back().set(i);
+        }
+
+        // a nested scope does not reset the arena
+        {
+            ScratchArena::Scope inner(arena);
+        }
+
+        size_t count = 0;
+        for (auto& set: sets) {
+            count += set.count();
+        }
+        std::cout << "build " << build << ": count (expected 20): " << count
+            << ", fits in buffer (expected " << (build > 0) << "): "
+            << (arena.getBytesUsed() <= arena.getCapacity()) << std::endl;
+    }
+    std::cout << "used after builds (expected 0): " << arena.getBytesUsed()
+        << std::endl;
+    std::cout << "peak within capacity (expected 1): "
+        << (arena.getPeakBytes() <= arena.getCapacity()) << std::endl;
+
+    // a copy of a set from the arena does not use the arena
+    Bitset copy(1, false);
+    {
+        ScratchArena::Scope scope(arena);
+        Bitset scratch(100, true, &arena);
+        copy = scratch;
+    }
+    std::cout << "copy count (expected 100): " << copy.count() << std::endl;
+
+    return 0;
+}
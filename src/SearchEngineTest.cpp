@@ -25,5 +25,21 @@ int main()
                   << std::setw(16) << res.value * 100 << " similarity score"
                   << std::endl;
     }
+
+    // Entries can be added, renamed and erased without indexing again.
+    size_t added = search.insert("Moreau Second Year Experience", 1);
+    std::cout << "Top result after insert: "
+              << search.search("moreau second year", 0.01, 1).at(0).name << std::endl;
+    search.update(added, "Quantum Basket Weaving", 1);
+    std::cout << "Top result after update: "
+              << search.search("quantum basket", 0.01, 1).at(0).name << std::endl;
+    search.erase(added);
+    std::cout << "Results after erase: "
+              << search.search("quantum basket weaving", 0.3).size() << std::endl;
+
+    // How long the searches took, and how many there were.
+    std::cout << std::endl;
+    Metrics::global().dump(std::cout);
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
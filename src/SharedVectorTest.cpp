@@ -29,5 +29,18 @@ int main() {
     V.flushQueue();
     V.display();
 
+    // store the first 4 elements inline: copies are independent until the
+    // vector spills past 4 elements, after which they share storage
+    SharedVector<int, 4> I;
+    for (int i = 0; i < 6; ++i) {
+        SharedVector<int, 4> B = I;
+        I.queue(i);
+        I.flushQueue();
+        B.queue(k);
+        B.flushQueue();
+        B.display();
+    }
+    I.display();
+
     return 0;
-}
\ No newline at end of file
+}
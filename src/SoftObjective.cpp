@@ -0,0 +1,119 @@
+
+#include "SoftObjective.h"
+#include <algorithm>
+#include <cmath>
+
+// WeekOccupancy constructor for an empty week
+WeekOccupancy::WeekOccupancy(double lengthOfDay) :
+	dayLength(lengthOfDay),
+	first(),
+	last(),
+	busy(),
+	totalGaps(0) {
+
+	this -> busy.fill(0);
+	this -> first.fill(0);
+	this -> last.fill(0);
+}
+
+// dayOf
+// the day of the week that a time falls on; times past the end of the week
+// wrap around
+unsigned int WeekOccupancy::dayOf(double time) const {
+	double day = std::floor(time / this -> dayLength);
+	return (unsigned int)std::fmod(std::fmod(day, DAYS) + DAYS, DAYS);
+}
+
+// timeOfDay
+// the time since the start of the day that a time falls on
+double WeekOccupancy::timeOfDay(double time) const {
+	return time - std::floor(time / this -> dayLength) * this -> dayLength;
+}
+
+// isUsed
+// whether the day has any class
+bool WeekOccupancy::isUsed(unsigned int day) const {
+	return this -> busy[day] > 0;
+}
+
+// getTotalGaps
+// the idle time between classes, summed over every day
+double WeekOccupancy::getTotalGaps() const {
+	return this -> totalGaps;
+}
+
+// gapsAfter
+// what getTotalGaps would return after adding the interval [begin, end); the
+// interval must not overlap any interval already added
+double WeekOccupancy::gapsAfter(double begin, double end) const {
+	unsigned int day = this -> dayOf(begin);
+	if (!this -> isUsed(day)) {
+		return this -> totalGaps;
+	}
+
+	double oldGaps = this -> last[day] - this -> first[day] - this -> busy[day];
+	double newGaps = std::max(this -> last[day], end)
+		- std::min(this -> first[day], begin) - this -> busy[day] - (end - begin);
+	return this -> totalGaps - oldGaps + newGaps;
+}
+
+// add
+// add the interval [begin, end) to the week
+void WeekOccupancy::add(double begin, double end) {
+	unsigned int day = this -> dayOf(begin);
+	this -> totalGaps = this -> gapsAfter(begin, end);
+	if (!this -> isUsed(day)) {
+		this -> first[day] = begin;
+		this -> last[day] = end;
+	}
+	else {
+		this -> first[day] = std::min(this -> first[day], begin);
+		this -> last[day] = std::max(this -> last[day], end);
+	}
+	this -> busy[day] += end - begin;
+}
+
+// recoverable
+// by default adding intervals never lowers the cost
+double SoftObjective::recoverable(const WeekOccupancy&) const {
+	return 0;
+}
+
+// delta
+// the change in total idle time
+double GapObjective::delta(const WeekOccupancy& week, double begin,
+	double end) const {
+
+	return week.gapsAfter(begin, end) - week.getTotalGaps();
+}
+
+// recoverable
+// intervals that fill gaps can remove all of the idle time, but no more
+double GapObjective::recoverable(const WeekOccupancy& week) const {
+	return week.getTotalGaps();
+}
+
+// EarlyStartObjective constructor
+EarlyStartObjective::EarlyStartObjective(double earliestStart) :
+	earliest(earliestStart) {}
+
+// delta
+// 1 if the interval starts too early in its day
+double EarlyStartObjective::delta(const WeekOccupancy& week, double begin,
+	double) const {
+
+	return week.timeOfDay(begin) < this -> earliest ? 1 : 0;
+}
+
+// FreeDayObjective constructor
+FreeDayObjective::FreeDayObjective(unsigned int day) :
+	freeDay(day) {}
+
+// delta
+// 1 if the interval is the first one on the day that should be free
+double FreeDayObjective::delta(const WeekOccupancy& week, double begin,
+	double) const {
+
+	unsigned int day = week.dayOf(begin);
+	return day == this -> freeDay && !week.isUsed(day) ? 1 : 0;
+}
@@ -1,6 +1,7 @@
 
 #include "TopElemsHeap.h"
 #include <iostream>
+#include <string>
 
 int main() {
 
@@ -23,5 +24,24 @@ int main() {
         std::cout << std::endl;
     }
 
+    // add all 30 elements at once, and take them out highest first
+    TopElemsHeap<int> bulk10(10);
+    bulk10.pushRange(elems.begin(), elems.end());
+    for (int elem: bulk10.drainSorted()) {
+        std::cout << elem << ", ";
+    }
+    std::cout << std::endl;
+
+    // keep the 5 names with the highest scores, comparing only the scores
+    typedef std::pair<std::string, int> Named;
+    TopElemsHeap<Named, int Named::*> top5(5, &Named::second);
+    for (size_t i = 0; i < elems.size(); ++i) {
+        top5.emplace("name" + std::to_string(i), elems[i]);
+    }
+    for (auto& named: top5.drainSorted()) {
+        std::cout << named.first << "=" << named.second << ", ";
+    }
+    std::cout << std::endl;
+
     return 0;
 }
\ No newline at end of file